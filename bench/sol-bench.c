@@ -0,0 +1,402 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: sol-bench.c
+ * description: Benchmarks of the Game of Life with reproducible workloads
+ * author: Donkey Coding Group
+ *
+ * This program measures the generation step, the drawing routines, the
+ * rendering into a PPM Image Buffer and the PPM writers on boards seeded
+ * from a fixed seed, and prints the results as JSON along with how the
+ * program was built. Every benchmark is repeated until it ran for the
+ * requested time, and the numbers are rates:
+ *
+ *     $ build/sol-bench --seconds 0.5 --max-size 4096 > results.json */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <time.h>
+
+#include "../src/gol.h"
+#include "../src/golppm.h"
+#include "../src/ppm.h"
+
+/* The seed of all workloads. Each benchmark derives its own from it, so
+ * the boards don't depend on which benchmarks run before. */
+#define SOL_BENCH_SEED 0x536c6963654c6966ull
+
+/* The optimisation and the compiler of the build, as the compiler reports
+ * them. The Craftfile builds the library with the same flags. */
+#if defined(__OPTIMIZE_SIZE__)
+#define SOL_BENCH_OPTIMIZE "size"
+#elif defined(__OPTIMIZE__)
+#define SOL_BENCH_OPTIMIZE "speed"
+#else
+#define SOL_BENCH_OPTIMIZE "none"
+#endif
+#ifdef __VERSION__
+#define SOL_BENCH_COMPILER __VERSION__
+#else
+#define SOL_BENCH_COMPILER "unknown"
+#endif
+#ifdef GOL_NO_PROFILE
+#define SOL_BENCH_PROFILE "false"
+#else
+#define SOL_BENCH_PROFILE "true"
+#endif
+
+/* The largest PPM Image Buffer that is rendered into. Larger boards are
+ * scaled down. */
+#define SOL_BENCH_MAX_IMAGE 2048
+
+/* Options from the command line. */
+typedef struct sol_bench_options {
+    /* The time that each benchmark runs for, in seconds. */
+    double seconds;
+
+    /* The largest board size that is benchmarked. */
+    uint32_t max_size;
+} sol_bench_options_t;
+
+/* The workloads of the generation step. */
+typedef enum SOL_BENCH_WORKLOAD {
+    SOL_BENCH_SOUP = 0,
+    SOL_BENCH_GLIDERS,
+    SOL_BENCH_GUNS,
+    SOL_BENCH_WORKLOADS,
+} SOL_BENCH_WORKLOAD;
+
+static const char* sol_bench_workload_names[SOL_BENCH_WORKLOADS] = {
+    "soup",
+    "gliders",
+    "guns",
+};
+
+/* The sizes of the square boards. */
+static const uint32_t sol_bench_sizes[] = {64, 256, 1024, 4096, 16384};
+
+/* The state of the random number generator, and whether a result has been
+ * written already. */
+static uint64_t sol_bench_state;
+static bool sol_bench_first_result = true;
+
+
+/* Seeds the random number generator for a benchmark. */
+static void sol_bench_seed(uint64_t a, uint64_t b) {
+    sol_bench_state = SOL_BENCH_SEED ^ (a * 0x9e3779b97f4a7c15ull) ^
+                      (b * 0xbf58476d1ce4e5b9ull);
+    if (sol_bench_state == 0) sol_bench_state = SOL_BENCH_SEED;
+}
+
+/* Returns the next number of the xorshift64* generator. */
+static uint64_t sol_bench_random(void) {
+    sol_bench_state ^= sol_bench_state >> 12;
+    sol_bench_state ^= sol_bench_state << 25;
+    sol_bench_state ^= sol_bench_state >> 27;
+    return sol_bench_state * 0x2545f4914f6cdd1dull;
+}
+
+/* Returns the time of the monotonic clock in seconds. */
+static double sol_bench_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/* Writes a result as a JSON object. The rates are left out if their count
+ * is zero. */
+static void sol_bench_report(
+        const char* name, const char* workload, uint32_t size, bool adjacency,
+        uint64_t iterations, double seconds, uint64_t generations,
+        uint64_t cells, uint64_t bytes) {
+    printf("%s\n    {\"name\": \"%s\", \"workload\": \"%s\", \"size\": %"PRIu32
+           ", \"adjacency\": %s, \"iterations\": %"PRIu64", \"seconds\": %.6f",
+           sol_bench_first_result ? "" : ",", name, workload, size,
+           adjacency ? "true" : "false", iterations, seconds);
+    if (generations) {
+        printf(", \"generations_per_sec\": %.3f", generations / seconds);
+    }
+    if (cells) printf(", \"cells_per_sec\": %.1f", cells / seconds);
+    if (bytes) printf(", \"bytes_per_sec\": %.1f", bytes / seconds);
+    printf("}");
+    fflush(stdout);
+    sol_bench_first_result = false;
+}
+
+/* Fills a board with a workload. */
+static void sol_bench_fill(game_of_life_t* game, SOL_BENCH_WORKLOAD workload) {
+    uint32_t x, y, w;
+    switch (workload) {
+        case SOL_BENCH_SOUP:
+            /* Every cell is alive with a probability of one half. */
+            for (y=0; y < game->height; y++) {
+                uint64_t* row = game_of_life_row(game, y);
+                for (w=0; w < game->stride; w++) row[w] = sol_bench_random();
+                if (game->width % 64) {
+                    row[game->stride - 1] &= ((uint64_t) 1 << (game->width % 64)) - 1;
+                }
+            }
+            game_of_life_wake(game);
+            break;
+        case SOL_BENCH_GLIDERS:
+            /* A glider in a random direction in every square of 32x32
+             * cells. */
+            for (y=0; y + 3 <= game->height; y += 32) {
+                for (x=0; x + 3 <= game->width; x += 32) {
+                    uint64_t r = sol_bench_random();
+                    game_of_life_draw_glider(game, x + r % 29, y + (r >> 8) % 29,
+                                             GOL_ROT_0, (r >> 16) & 3);
+                }
+            }
+            break;
+        case SOL_BENCH_GUNS:
+            /* A glider gun in every square of 64x64 cells. */
+            for (y=0; y + 9 <= game->height; y += 64) {
+                for (x=0; x + 36 <= game->width; x += 64) {
+                    uint64_t r = sol_bench_random();
+                    game_of_life_draw_glidergun(game, x, y, GOL_ROT_0, r & 3);
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/* Benchmarks the generation step on a workload. */
+static void sol_bench_step(
+        const sol_bench_options_t* options, SOL_BENCH_WORKLOAD workload,
+        uint32_t size, bool adjacency) {
+    game_of_life_t* game = game_of_life_create(size, size, adjacency);
+    if (game == NULL) {
+        fprintf(stderr, "sol-bench: a board of %"PRIu32"x%"PRIu32" could not "
+                        "be allocated\n", size, size);
+        return;
+    }
+    sol_bench_seed(workload, size);
+    sol_bench_fill(game, workload);
+
+    uint64_t generations = 0;
+    double start = sol_bench_now();
+    double elapsed;
+    do {
+        game_of_life_next_generation(game);
+        generations++;
+        elapsed = sol_bench_now() - start;
+    } while (elapsed < options->seconds);
+
+    sol_bench_report("next_generation", sol_bench_workload_names[workload],
+                     size, adjacency, generations, elapsed, generations,
+                     generations * size * size, 0);
+    game_of_life_destroy(game);
+}
+
+/* Benchmarks the drawing routines on an empty torus. */
+static void sol_bench_draw(const sol_bench_options_t* options, uint32_t size) {
+    static const char gun[] =
+            "                        X           "
+            "                      X X           "
+            "            XX      XX            XX"
+            "           X   X    XX            XX"
+            "XX        X     X   XX              "
+            "XX        X   X XX    X X           "
+            "          X     X       X           "
+            "           X   X                    "
+            "            XX                      ";
+    game_of_life_t* game = game_of_life_create(size, size, true);
+    game_of_life_pattern_t* compiled = game_of_life_pattern_compile(gun, 36, 9);
+    uint64_t iterations;
+    double start, elapsed;
+    int kind;
+    if (game == NULL || compiled == NULL) {
+        game_of_life_pattern_destroy(compiled);
+        game_of_life_destroy(game);
+        return;
+    }
+
+    for (kind=0; kind < 3; kind++) {
+        const char* name = kind == 0 ? "draw_glidergun"
+                         : kind == 1 ? "draw_compiled" : "draw_block";
+        uint64_t cells = kind == 2 ? 32 * 32 : 36 * 9;
+        sol_bench_seed(100 + kind, size);
+        iterations = 0;
+        start = sol_bench_now();
+        do {
+            uint64_t r = sol_bench_random();
+            int32_t x = r % size;
+            int32_t y = (r >> 20) % size;
+            GOL_ROT rotation = (r >> 40) & 3;
+            GOL_FLIP flip = (r >> 42) & 3;
+            if (kind == 0) {
+                game_of_life_draw_glidergun(game, x, y, rotation, flip);
+            }
+            else if (kind == 1) {
+                game_of_life_draw_compiled(game, compiled, x, y, rotation, flip, true);
+            }
+            else {
+                game_of_life_draw_block(game, x, y, 32, 32, (r >> 44) & 1);
+            }
+            iterations++;
+            elapsed = sol_bench_now() - start;
+        } while (elapsed < options->seconds);
+        sol_bench_report(name, "random", size, true, iterations, elapsed, 0,
+                         iterations * cells, 0);
+    }
+
+    game_of_life_pattern_destroy(compiled);
+    game_of_life_destroy(game);
+}
+
+/* A PPM Outstream that only counts the bytes written to it. */
+static size_t sol_bench_count_write(
+        const ppm_outstream_t* stream, const char* buffer, size_t size) {
+    (void) buffer;
+    *(uint64_t*) stream->object += size;
+    return size;
+}
+
+/* Benchmarks :func:`gol_to_ppm` and the PPM writers on a soup. */
+static void sol_bench_ppm(const sol_bench_options_t* options, uint32_t size) {
+    uint32_t image = size < SOL_BENCH_MAX_IMAGE ? size : SOL_BENCH_MAX_IMAGE;
+    game_of_life_t* game = game_of_life_create(size, size, true);
+    ppm_pixel_buffer_t* buffer = ppm_pixel_buffer_create(image, image, 255);
+    uint64_t iterations, bytes;
+    double start, elapsed;
+    int mode;
+    if (game == NULL || buffer == NULL) {
+        if (buffer) ppm_pixel_buffer_destroy(buffer);
+        game_of_life_destroy(game);
+        return;
+    }
+    sol_bench_seed(200, size);
+    sol_bench_fill(game, SOL_BENCH_SOUP);
+
+    struct gol_to_ppm_params params;
+    params.scale = (float) size / image;
+    params.xoff = params.yoff = 0;
+    params.calive.r = 255;
+    params.calive.g = 255;
+    params.calive.b = 0;
+    params.cdead.r = params.cdead.g = params.cdead.b = 0;
+    params.game = game;
+    params.buffer = buffer;
+
+    uint64_t pixels = (uint64_t) image * image;
+    iterations = 0;
+    start = sol_bench_now();
+    do {
+        gol_to_ppm(params);
+        iterations++;
+        elapsed = sol_bench_now() - start;
+    } while (elapsed < options->seconds);
+    sol_bench_report("gol_to_ppm", "soup", size, true, iterations, elapsed, 0,
+                     iterations * pixels, iterations * pixels * sizeof(ppm_pixel_t));
+
+    for (mode=0; mode < 2; mode++) {
+        ppm_outstream_t stream;
+        stream.object = &bytes;
+        stream.write = sol_bench_count_write;
+        stream.destroy = NULL;
+        bytes = 0;
+        iterations = 0;
+        start = sol_bench_now();
+        do {
+            ppm_write_pixel_buffer(buffer, &stream,
+                                   mode ? PPM_MODE_PLAIN : PPM_MODE_BINARY);
+            iterations++;
+            elapsed = sol_bench_now() - start;
+        } while (elapsed < options->seconds);
+        sol_bench_report(mode ? "ppm_write_plain" : "ppm_write_binary", "soup",
+                         image, true, iterations, elapsed, 0,
+                         iterations * pixels, bytes);
+    }
+
+    ppm_pixel_buffer_destroy(buffer);
+    game_of_life_destroy(game);
+}
+
+/* Returns the name of the kernel that new games use on this machine. */
+static const char* sol_bench_kernel(void) {
+    game_of_life_t* game = game_of_life_create(1, 1, false);
+    if (game == NULL) return "unknown";
+    const char* name = game_of_life_kernel_name(game->kernel);
+    game_of_life_destroy(game);
+    return name;
+}
+
+/* Parses the command line. Returns false if it is invalid. */
+static bool sol_bench_options(
+        int argc, char** argv, sol_bench_options_t* options) {
+    int i;
+    options->seconds = 0.25;
+    options->max_size = 16384;
+    for (i=1; i < argc; i++) {
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            options->seconds = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--max-size") == 0 && i + 1 < argc) {
+            options->max_size = strtoul(argv[++i], NULL, 10);
+        }
+        else {
+            return false;
+        }
+    }
+    return options->seconds > 0;
+}
+
+
+int main(int argc, char** argv) {
+    sol_bench_options_t options;
+    size_t i;
+    int workload, adjacency;
+
+    if (!sol_bench_options(argc, argv, &options)) {
+        fprintf(stderr, "usage: sol-bench [--seconds S] [--max-size N]\n");
+        return 2;
+    }
+
+    printf("{\n  \"suite\": \"sol-bench\",\n  \"version\": 2,\n"
+           "  \"seed\": %"PRIu64",\n  \"seconds\": %.3f,\n"
+           "  \"kernel\": \"%s\",\n"
+           "  \"build\": {\"optimize\": \"%s\", \"profile\": %s, "
+           "\"compiler\": \"%s\"},\n  \"results\": [",
+           (uint64_t) SOL_BENCH_SEED, options.seconds,
+           sol_bench_kernel(), SOL_BENCH_OPTIMIZE, SOL_BENCH_PROFILE,
+           SOL_BENCH_COMPILER);
+
+    for (i=0; i < sizeof(sol_bench_sizes) / sizeof(sol_bench_sizes[0]); i++) {
+        uint32_t size = sol_bench_sizes[i];
+        if (size > options.max_size) break;
+        for (workload=0; workload < SOL_BENCH_WORKLOADS; workload++) {
+            for (adjacency=1; adjacency >= 0; adjacency--) {
+                sol_bench_step(&options, workload, size, adjacency);
+            }
+        }
+        sol_bench_draw(&options, size);
+        sol_bench_ppm(&options, size);
+    }
+
+    printf("\n  ]\n}\n");
+    return 0;
+}
@@ -25,21 +25,163 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "gol.h"
+#include "golkernel.h"
+#include "golpool.h"
+#include "golprof.h"
+
+/* The number of generations that :func:`game_of_life_advance` calculates
+ * in a band of rows before moving on to the next band. */
+#define GOL_BLOCK_DEPTH 8
+
+/* The size of the buffers of a thread that calculate a band of rows over
+ * several generations, sized to stay in the cache of a core. */
+#define GOL_BLOCK_BYTES (512 * 1024)
+
+/* The identification of a snapshot file and the version of its format. */
+#define GOL_SNAPSHOT_MAGIC "SOLSNAP"
+#define GOL_SNAPSHOT_VERSION 2
+#define GOL_SNAPSHOT_BYTE_ORDER 0x01020304
+
+/* The grid of a snapshot starts at a multiple of this many bytes. */
+#define GOL_SNAPSHOT_ALIGN 4096
+
+/* The size of a huge page, the smallest grid that is backed by them, and
+ * the number of words of a small page. */
+#define GOL_HUGE_PAGE ((size_t) 2 << 20)
+#define GOL_PAGE_WORDS (4096 / sizeof(uint64_t))
 
 
 /* This utility function implements a cyclic modular calculation. This means,
  * for instance, that if a value of -1 is passed for *x*, the result will
  * be ``v - 1``. */
 static int _casemod(int x, int v) {
-    int r = abs(x % v);
-    if (x < 0) r = v - r;
+    int r = x % v;
+    if (r < 0) r += v;
     return r;
 }
 
 
-game_of_life_t* game_of_life_create(
-        uint32_t width, uint32_t height, bool adjacency) {
+/* Maps the X and Y coordinate into the grid. Returns false if the
+ * coordinate lies outside of a grid without adjacency. */
+static bool _gol_locate(const game_of_life_t* game, int32_t* x, int32_t* y) {
+    if (game->adjacency) {
+        *x = _casemod(*x, game->width);
+        *y = _casemod(*y, game->height);
+    }
+    else if (*x < 0 || *y < 0 || *x >= game->width || *y >= game->height) {
+        return false;
+    }
+    return true;
+}
+
+
+/* Returns the hash of the word at *index* of the grid, counting words from
+ * the first row on without the halo. Empty words hash to zero. */
+static inline uint64_t _gol_hash_word(size_t index, uint64_t word) {
+    if (word == 0) return 0;
+    uint64_t x = word ^ ((uint64_t) index * 0x9e3779b97f4a7c15ull);
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+/* Forgets the hashes of the past generations, after the board or the rule
+ * changed in a way that the history does not describe. */
+static void _gol_history_reset(game_of_life_t* game) {
+    game->history_count = 0;
+    game->history_next = 0;
+    game->period = 0;
+    game->candidate = 0;
+}
+
+/* Appends the hash of a generation to the history. */
+static void _gol_history_push(
+        game_of_life_t* game, uint64_t generation, uint64_t hash) {
+    game->history[game->history_next].generation = generation;
+    game->history[game->history_next].hash = hash;
+    game->history_next = (game->history_next + 1) % GOL_HISTORY;
+    if (game->history_count < GOL_HISTORY) game->history_count++;
+}
+
+/* Returns the index of the history entry of *age* generations ago, with
+ * an age of one being the last entry. */
+static uint32_t _gol_history_index(const game_of_life_t* game, uint32_t age) {
+    return (game->history_next + GOL_HISTORY - age) % GOL_HISTORY;
+}
+
+/* Returns *offset* rounded up to a multiple of *align*. */
+static size_t _gol_align(size_t offset, size_t align) {
+    return (offset + align - 1) / align * align;
+}
+
+/* Returns the size in bytes of a grid of *height* rows of *pitch* words,
+ * with its halo rows. */
+static size_t _gol_grid_size(uint32_t pitch, uint32_t height) {
+    return sizeof(uint64_t) * pitch * ((size_t) height + 2);
+}
+
+/* Allocates a grid of *height* rows of *pitch* words, surrounded by a halo
+ * row above and below, initialized to zeros. Returns a pointer to the first
+ * cell word of the first row, which is preceded by its western halo word.
+ * Grids of GOL_HUGE_PAGE bytes and more are mapped at an address aligned
+ * to a huge page and advised to be backed by huge pages, which saves most
+ * of the TLB misses of stepping a large board. Their pages are allocated
+ * when they are first written, see :func:`_gol_touch_task`. */
+static uint64_t* _gol_grid_alloc(uint32_t pitch, uint32_t height) {
+    size_t size = _gol_grid_size(pitch, height);
+    uint64_t* block;
+    if (size < GOL_HUGE_PAGE) {
+        block = calloc(size, 1);
+        return block ? block + pitch + 1 : NULL;
+    }
+
+    size = _gol_align(size, GOL_HUGE_PAGE);
+    char* map = mmap(NULL, size + GOL_HUGE_PAGE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) return NULL;
+    char* start = (char*) _gol_align((uintptr_t) map, GOL_HUGE_PAGE);
+    if (start > map) munmap(map, start - map);
+    munmap(start + size, map + GOL_HUGE_PAGE - start);
+#ifdef MADV_HUGEPAGE
+    madvise(start, size, MADV_HUGEPAGE);
+#endif
+    block = (uint64_t*) start;
+    return block + pitch + 1;
+}
+
+/* Frees a grid allocated with :func:`_gol_grid_alloc`. */
+static void _gol_grid_free(uint64_t* cells, uint32_t pitch, uint32_t height) {
+    size_t size = _gol_grid_size(pitch, height);
+    if (cells == NULL) return;
+    if (size < GOL_HUGE_PAGE) {
+        free(cells - pitch - 1);
+    }
+    else {
+        munmap(cells - pitch - 1, _gol_align(size, GOL_HUGE_PAGE));
+    }
+}
+
+/* Writes to every page of *count* words without changing them, which
+ * allocates the pages that were not written yet. */
+static void _gol_touch(uint64_t* words, size_t count) {
+    size_t i;
+    for (i=0; i < count; i += GOL_PAGE_WORDS) {
+        __atomic_fetch_or(&words[i], 0, __ATOMIC_RELAXED);
+    }
+    if (count > 0) __atomic_fetch_or(&words[count - 1], 0, __ATOMIC_RELAXED);
+}
+
+
+/* Allocates a game and its tiles. The grids are allocated as well if
+ * *grids* is true, otherwise they are left to the caller. The tiles are
+ * left uninitialized. */
+static game_of_life_t* _gol_alloc(
+        uint32_t width, uint32_t height, bool adjacency, bool grids) {
     /* Validate the parameters. */
     if (width < 1 || height < 1) return NULL;
 
@@ -49,221 +191,1710 @@ game_of_life_t* game_of_life_create(
         return NULL;
     }
 
-    /* Allocate the array of the Cells. */
-    size_t cells_size = sizeof(cell_t) * width * height;
-    cell_t* cells = malloc(cells_size);
-    if (cells == NULL) {
+    /* Allocate the bit-packed grids of the current and the previous
+     * generation, initialized to dead cells. */
+    uint32_t stride = (width + 63) / 64;
+    uint32_t pitch = stride + 2;
+    uint64_t* cells = grids ? _gol_grid_alloc(pitch, height) : NULL;
+    if (grids && cells == NULL) {
+        free(game);
+        return NULL;
+    }
+    uint64_t* prev_cells = grids ? _gol_grid_alloc(pitch, height) : NULL;
+    if (grids && prev_cells == NULL) {
+        _gol_grid_free(cells, pitch, height);
         free(game);
         return NULL;
     }
 
-    /* Initialize all cells to zero. */
-    memset(cells, cells_size, 0);
+    /* Allocate the tile flags. */
+    uint32_t tiles_y = (height + GOL_TILE_ROWS - 1) / GOL_TILE_ROWS;
+    uint8_t* tiles = malloc((size_t) stride * tiles_y);
+    uint64_t* tile_hash = malloc(sizeof(uint64_t) * stride * tiles_y);
+    uint64_t* tile_next_hash = calloc((size_t) stride * tiles_y, sizeof(uint64_t));
+    uint32_t* tile_population = malloc(sizeof(uint32_t) * stride * tiles_y);
+    uint32_t* tile_births = calloc((size_t) stride * tiles_y, sizeof(uint32_t));
+    uint32_t* tile_deaths = calloc((size_t) stride * tiles_y, sizeof(uint32_t));
+    if (tiles == NULL || tile_hash == NULL || tile_next_hash == NULL ||
+            tile_population == NULL || tile_births == NULL || tile_deaths == NULL) {
+        free(tiles);
+        free(tile_hash);
+        free(tile_next_hash);
+        free(tile_population);
+        free(tile_births);
+        free(tile_deaths);
+        _gol_grid_free(prev_cells, pitch, height);
+        _gol_grid_free(cells, pitch, height);
+        free(game);
+        return NULL;
+    }
 
     game->width = width;
     game->height = height;
     game->generation = 0;
+    game->stride = stride;
+    game->pitch = pitch;
     game->cells = cells;
+    game->prev_cells = prev_cells;
+    game->stepping = false;
+    game->step_row = 0;
+    game->step_hash = 0;
+    game->step_time = 0;
+    game->tiles_x = stride;
+    game->tiles_y = tiles_y;
+    game->tiles = tiles;
+    game->tile_hash = tile_hash;
+    game->tile_next_hash = tile_next_hash;
+    game->tile_population = tile_population;
+    game->tile_births = tile_births;
+    game->tile_deaths = tile_deaths;
+    memset(&game->stats, 0, sizeof(game->stats));
+    game->threads = 1;
+    game->pool = NULL;
     game->adjacency = adjacency;
-    game->keep_cell.min = 2;
-    game->keep_cell.max = 3;
-    game->make_cell.min = 3;
-    game->make_cell.max = 3;
+    game->rule = gol_rule_conway();
+    game->tile_rule = game->rule;
+    gol_rule_compile(game->rule, &game->compiled_rule);
+    memset(&game->ltl, 0, sizeof(game->ltl));
+    game->tile_ltl = game->ltl;
+    game->ltl_sums = NULL;
+    game->mappings[0] = game->mappings[1] = NULL;
+    game->mapping_size = 0;
+    game_of_life_set_kernel(game, GOL_KERNEL_AUTO);
+    _gol_history_reset(game);
+
+    return game;
+}
 
+game_of_life_t* game_of_life_create(
+        uint32_t width, uint32_t height, bool adjacency) {
+    game_of_life_t* game = _gol_alloc(width, height, adjacency, true);
+    if (game) game_of_life_wake(game);
+    return game;
+}
+
+game_of_life_t* game_of_life_create_threaded(
+        uint32_t width, uint32_t height, bool adjacency, uint32_t threads) {
+    game_of_life_t* game = game_of_life_create(width, height, adjacency);
+    if (game && !game_of_life_set_threads(game, threads)) {
+        game_of_life_destroy(game);
+        return NULL;
+    }
     return game;
 }
 
 void game_of_life_destroy(game_of_life_t* game) {
     if (game) {
-        if (game->cells) free(game->cells);
+        if (game->pool) gol_pool_destroy(game->pool);
+        game->pool = NULL;
+        if (game->mappings[0]) {
+            munmap(game->mappings[0], game->mapping_size);
+            munmap(game->mappings[1], game->mapping_size);
+        }
+        else {
+            _gol_grid_free(game->cells, game->pitch, game->height);
+            _gol_grid_free(game->prev_cells, game->pitch, game->height);
+        }
+        if (game->tiles) free(game->tiles);
+        if (game->tile_hash) free(game->tile_hash);
+        if (game->tile_next_hash) free(game->tile_next_hash);
+        if (game->tile_population) free(game->tile_population);
+        if (game->tile_births) free(game->tile_births);
+        if (game->tile_deaths) free(game->tile_deaths);
+        free(game->ltl_sums);
         game->cells = NULL;
+        game->prev_cells = NULL;
+        game->tiles = NULL;
+        game->tile_hash = NULL;
+        game->tile_next_hash = NULL;
+        game->tile_population = NULL;
+        game->tile_births = NULL;
+        game->tile_deaths = NULL;
+        game->ltl_sums = NULL;
+        game->mappings[0] = game->mappings[1] = NULL;
         free(game);
     }
 }
 
-cell_t* game_of_life_cell(const game_of_life_t* game, int32_t x, int32_t y) {
-    if (game->adjacency) {
-        x = _casemod(x, game->width);
-        y = _casemod(y, game->height);
-    }
-    else if (x < 0 || y < 0 || x >= game->width || y >= game->height) {
-        return NULL;
+bool game_of_life_cell(const game_of_life_t* game, int32_t x, int32_t y) {
+    if (!_gol_locate(game, &x, &y)) return false;
+    uint64_t word = game->cells[(size_t) y * game->pitch + x / 64];
+    return (word >> (x % 64)) & 1;
+}
+
+uint64_t* game_of_life_row(const game_of_life_t* game, uint32_t y) {
+    return game->cells + (size_t) y * game->pitch;
+}
+
+bool game_of_life_prev_cell(const game_of_life_t* game, int32_t x, int32_t y) {
+    if (!_gol_locate(game, &x, &y)) return false;
+    uint64_t word = game->prev_cells[(size_t) y * game->pitch + x / 64];
+    return (word >> (x % 64)) & 1;
+}
+
+const uint64_t* game_of_life_prev_row(const game_of_life_t* game, uint32_t y) {
+    return game->prev_cells + (size_t) y * game->pitch;
+}
+
+void game_of_life_wake(const game_of_life_t* game) {
+    uint32_t stride = game->stride;
+    uint32_t y, w;
+    memset(game->tiles, GOL_TILE_CHANGED, (size_t) game->tiles_x * game->tiles_y);
+    memset(game->tile_hash, 0, sizeof(uint64_t) * game->tiles_x * game->tiles_y);
+    memset(game->tile_population, 0, sizeof(uint32_t) * game->tiles_x * game->tiles_y);
+    for (y=0; y < game->height; y++) {
+        const uint64_t* row = game_of_life_row(game, y);
+        size_t tile = (size_t) (y / GOL_TILE_ROWS) * game->tiles_x;
+        for (w=0; w < stride; w++) {
+            game->tile_hash[tile + w] ^= _gol_hash_word((size_t) y * stride + w, row[w]);
+            game->tile_population[tile + w] += gol_kernel_popcount(row[w]);
+        }
     }
-    return &game->cells[x + y * game->width];
 }
 
 void game_of_life_cell_set(
         const game_of_life_t* game, int32_t x, int32_t y, bool state) {
-    cell_t* cell = game_of_life_cell(game, x, y);
-    if (cell) {
-        cell->state = state;
+    if (!_gol_locate(game, &x, &y)) return;
+    uint64_t* word = &game->cells[(size_t) y * game->pitch + x / 64];
+    uint64_t bit = (uint64_t) 1 << (x % 64);
+    uint64_t value = state ? (*word | bit) : (*word & ~bit);
+    if (value != *word) {
+        size_t index = (size_t) y * game->stride + x / 64;
+        size_t tile = (size_t) (y / GOL_TILE_ROWS) * game->tiles_x + x / 64;
+        game->tiles[tile] |= GOL_TILE_CHANGED;
+        game->tile_hash[tile] ^= _gol_hash_word(index, *word) ^
+                                 _gol_hash_word(index, value);
+        if (state) game->tile_population[tile]++;
+        else game->tile_population[tile]--;
+        *word = value;
     }
 }
 
-/* This utility function returns true if the cell at the specified cell
- * exists (ie. the index is not out of the grid's bounds) and is alive,
- * false in any other case. */
-static bool game_of_life_cell_state(
-        const game_of_life_t* game, int32_t x, int32_t y) {
-    cell_t* cell = game_of_life_cell(game, x, y);
-    if (cell) return cell->state;
-    else return 0;
+/* Sets the cells of *mask* in word *w* of row *y* to the bits of *value*,
+ * and updates the tile of the word like :func:`game_of_life_cell_set`
+ * does. */
+static void _gol_word_write(
+        const game_of_life_t* game, uint32_t y, uint32_t w, uint64_t mask,
+        uint64_t value) {
+    uint64_t* word = &game->cells[(size_t) y * game->pitch + w];
+    value = (*word & ~mask) | (value & mask);
+    if (value != *word) {
+        size_t index = (size_t) y * game->stride + w;
+        size_t tile = (size_t) (y / GOL_TILE_ROWS) * game->tiles_x + w;
+        uint64_t diff = value ^ *word;
+        game->tiles[tile] |= GOL_TILE_CHANGED;
+        game->tile_hash[tile] ^= _gol_hash_word(index, *word) ^
+                                 _gol_hash_word(index, value);
+        game->tile_population[tile] += gol_kernel_popcount(diff & value) -
+                                       gol_kernel_popcount(diff & *word);
+        *word = value;
+    }
+}
+
+/* Sets the cells [begin, end) of row *y*, which lie in the grid, a word
+ * at a time. */
+static void _gol_row_fill(
+        const game_of_life_t* game, uint32_t y, uint32_t begin, uint32_t end,
+        bool state) {
+    uint32_t first = begin / 64;
+    uint32_t last = (end - 1) / 64;
+    uint64_t head = ~(uint64_t) 0 << (begin % 64);
+    uint64_t tail = gol_kernel_tail_mask(end);
+    uint32_t w;
+    uint64_t value = state ? ~(uint64_t) 0 : 0;
+    if (first == last) {
+        _gol_word_write(game, y, first, head & tail, value);
+        return;
+    }
+    _gol_word_write(game, y, first, head, value);
+    for (w=first + 1; w < last; w++) {
+        _gol_word_write(game, y, w, ~(uint64_t) 0, value);
+    }
+    _gol_word_write(game, y, last, tail, value);
+}
+
+void game_of_life_draw_span(
+        const game_of_life_t* game, int32_t x, int32_t y, int64_t n,
+        bool state) {
+    int64_t width = game->width;
+    int64_t begin = x;
+    int64_t end = begin + n;
+    if (n <= 0) return;
+
+    if (game->adjacency) {
+        y = _casemod(y, game->height);
+        if (n >= width) {
+            _gol_row_fill(game, y, 0, width, state);
+            return;
+        }
+        begin = _casemod(x, width);
+        end = begin + n;
+        if (end > width) {
+            _gol_row_fill(game, y, 0, end - width, state);
+            end = width;
+        }
+    }
+    else {
+        if (y < 0 || y >= game->height) return;
+        if (begin < 0) begin = 0;
+        if (end > width) end = width;
+        if (begin >= end) return;
+    }
+    _gol_row_fill(game, y, begin, end, state);
 }
 
 int game_of_life_neighbour_count(
         const game_of_life_t* game, int32_t x, int32_t y) {
     int count = 0;
-    if (game_of_life_cell_state(game, x - 1, y - 1)) count++;
-    if (game_of_life_cell_state(game, x    , y - 1)) count++;
-    if (game_of_life_cell_state(game, x + 1, y - 1)) count++;
-    if (game_of_life_cell_state(game, x + 1, y    )) count++;
-    if (game_of_life_cell_state(game, x + 1, y + 1)) count++;
-    if (game_of_life_cell_state(game, x    , y + 1)) count++;
-    if (game_of_life_cell_state(game, x - 1, y + 1)) count++;
-    if (game_of_life_cell_state(game, x - 1, y    )) count++;
+    if (game->ltl.range) {
+        int32_t range = game->ltl.range;
+        int32_t dx, dy;
+        for (dy=-range; dy <= range; dy++) {
+            for (dx=-range; dx <= range; dx++) {
+                if ((dx || dy) && game_of_life_cell(game, x + dx, y + dy)) count++;
+            }
+        }
+        return count;
+    }
+    if (game_of_life_cell(game, x - 1, y - 1)) count++;
+    if (game_of_life_cell(game, x    , y - 1)) count++;
+    if (game_of_life_cell(game, x + 1, y - 1)) count++;
+    if (game_of_life_cell(game, x + 1, y    )) count++;
+    if (game_of_life_cell(game, x + 1, y + 1)) count++;
+    if (game_of_life_cell(game, x    , y + 1)) count++;
+    if (game_of_life_cell(game, x - 1, y + 1)) count++;
+    if (game_of_life_cell(game, x - 1, y    )) count++;
     return count;
 }
 
-void game_of_life_next_generation(game_of_life_t* game) {
+/* Calculates the rows [begin, end) of the specified band of the rows of
+ * tiles [first, last). Bands are made up of whole rows of tiles, so that
+ * the flags of a tile are only written by a single thread. */
+static void _gol_band_rows(
+        const game_of_life_t* game, uint32_t first, uint32_t last,
+        uint32_t band, uint32_t count, uint32_t* begin, uint32_t* end) {
+    *begin = (first + (uint64_t) (last - first) * band / count) * GOL_TILE_ROWS;
+    *end = (first + (uint64_t) (last - first) * (band + 1) / count) * GOL_TILE_ROWS;
+    if (*begin > game->height) *begin = game->height;
+    if (*end > game->height) *end = game->height;
+}
+
+/* Records the words [begin, end) of the next generation of row *i*, *out*,
+ * that differ from the current generation, *row*, in the flags, the next
+ * hashes and the counts of their tiles. The births and deaths are counted
+ * with the popcount instruction if *popcnt* is true. */
+__attribute__((always_inline))
+static inline void _gol_record_words(
+        const game_of_life_t* game, uint32_t i, const uint64_t* out,
+        const uint64_t* row, uint32_t begin, uint32_t end, bool popcnt) {
+    size_t tile = (size_t) (i / GOL_TILE_ROWS) * game->tiles_x;
+    uint32_t w;
+
+    /* The last word may carry a cell of the halo, see _gol_fill_halo(). */
+    for (w=begin; w < end; w++) {
+        uint64_t diff = out[w] ^ row[w];
+        if (w + 1 == game->stride) diff &= gol_kernel_tail_mask(game->width);
+        if (diff) {
+            size_t index = (size_t) i * game->stride + w;
+            int born, died;
+            if (popcnt) {
+                born = __builtin_popcountll(diff & out[w]);
+                died = __builtin_popcountll(diff) - born;
+            }
+            else {
+                born = gol_kernel_popcount(diff & out[w]);
+                died = gol_kernel_popcount(diff) - born;
+            }
+            game->tiles[tile + w] |= GOL_TILE_NEXT;
+            game->tile_next_hash[tile + w] ^= _gol_hash_word(index, out[w] ^ diff) ^
+                                              _gol_hash_word(index, out[w]);
+            game->tile_births[tile + w] += born;
+            game->tile_deaths[tile + w] += died;
+        }
+    }
+}
+
+/* Calculates the next generation of the active tiles of the specified band
+ * of the rows of tiles [first, last) into the grid of the previous
+ * generation. Inactive tiles already hold the same cells in both grids.
+ * The births and the population are counted with the popcount instruction
+ * if *popcnt* is true. */
+__attribute__((always_inline))
+static inline void _gol_step_rows(
+        const game_of_life_t* game, uint32_t first, uint32_t last,
+        uint32_t band, uint32_t count, bool popcnt) {
+    uint32_t pitch = game->pitch;
+    uint32_t begin, end, j;
+    _gol_band_rows(game, first, last, band, count, &begin, &end);
+
+    for (j=begin; j < end; j += GOL_TILE_ROWS) {
+        uint8_t* tiles = game->tiles + (size_t) (j / GOL_TILE_ROWS) * game->tiles_x;
+        uint32_t bottom = j + GOL_TILE_ROWS < end ? j + GOL_TILE_ROWS : end;
+        uint32_t t, i;
+
+        for (t=0; t < game->tiles_x && !(tiles[t] & GOL_TILE_ACTIVE); t++);
+        if (t == game->tiles_x) continue;
+
+        for (i=j; i < bottom; i++) {
+            const uint64_t* row = game->cells + (size_t) i * pitch;
+            uint64_t* out = game->prev_cells + (size_t) i * pitch;
+
+            /* Calculate each run of adjacent active tiles at once. The
+             * outer rows are neighboured by the halo rows. */
+            uint32_t w = 0;
+            while (w < game->tiles_x) {
+                if (!(tiles[w] & GOL_TILE_ACTIVE)) {
+                    w++;
+                    continue;
+                }
+                uint32_t run = w;
+                while (w < game->tiles_x && (tiles[w] & GOL_TILE_ACTIVE)) w++;
+                game->row_kernel(game, out, row - pitch, row, row + pitch, run, w);
+                _gol_record_words(game, i, out, row, run, w, popcnt);
+            }
+        }
+    }
+}
+
+#ifdef GOL_KERNEL_X86
+__attribute__((target("popcnt")))
+static void _gol_step_band_popcnt(
+        const game_of_life_t* game, uint32_t first, uint32_t last,
+        uint32_t band, uint32_t count) {
+    _gol_step_rows(game, first, last, band, count, true);
+}
+#endif /* GOL_KERNEL_X86 */
+
+/* The number of column sums of each thread for a Larger than Life rule. */
+static size_t _gol_ltl_sums_size(const game_of_life_t* game) {
+    return (size_t) game->width + 2 * GOL_LTL_MAX_RANGE + 1;
+}
+
+/* Allocates the column sums of *threads* threads for the Larger than Life
+ * rule *ltl*, or frees them if its range is zero. */
+static bool _gol_ltl_reserve(
+        game_of_life_t* game, const gol_ltl_rule_t* ltl, uint32_t threads) {
+    if (ltl->range == 0) {
+        free(game->ltl_sums);
+        game->ltl_sums = NULL;
+        return true;
+    }
+    uint16_t* sums = realloc(
+        game->ltl_sums, sizeof(uint16_t) * _gol_ltl_sums_size(game) * threads);
+    if (sums == NULL) return false;
+    game->ltl_sums = sums;
+    return true;
+}
+
+/* Adds the cells of row *y* to the column sums, or subtracts them if
+ * *sign* is negative. Rows beyond the edges wrap around if adjacency is
+ * enabled and are dead otherwise. */
+static void _gol_ltl_add_row(
+        const game_of_life_t* game, uint16_t* sums, int64_t y, int sign) {
+    uint32_t w;
+    if (game->adjacency) {
+        y = ((y % game->height) + game->height) % game->height;
+    }
+    else if (y < 0 || y >= game->height) {
+        return;
+    }
+
+    const uint64_t* row = game->cells + (size_t) y * game->pitch;
+    for (w=0; w < game->stride; w++) {
+        uint64_t word = row[w];
+        while (word) {
+            sums[w * 64 + __builtin_ctzll(word)] += sign;
+            word &= word - 1;
+        }
+    }
+}
+
+/* Calculates the band like :func:`_gol_step_rows` with the Larger than
+ * Life rule. The sums of the columns of the neighbourhood of each row are
+ * kept up to date by adding the row that enters it and subtracting the one
+ * that leaves it, and the neighbour counts along a row are running sums of
+ * the column sums, so that every cell costs the same for any range. The
+ * column sums are padded by the columns that the range reaches beyond the
+ * edges. */
+static void _gol_step_ltl_band(
+        const game_of_life_t* game, uint32_t first, uint32_t last,
+        uint32_t band, uint32_t count) {
+    const gol_ltl_rule_t* ltl = &game->tile_ltl;
+    int32_t range = ltl->range;
+    int32_t width = game->width;
+    size_t size = _gol_ltl_sums_size(game);
+    uint16_t* sums = game->ltl_sums + size * band + GOL_LTL_MAX_RANGE;
+    uint32_t begin, end, j;
+    uint32_t slide = UINT32_MAX;
+    int32_t x;
+
+    /* Bit 0 of an entry is the next state of a dead cell with that many
+     * neighbours, bit 1 the one of a living cell. */
+    uint8_t table[(2 * GOL_LTL_MAX_RANGE + 1) * (2 * GOL_LTL_MAX_RANGE + 1) + 1];
+    uint32_t c;
+    for (c=0; c < sizeof(table); c++) {
+        table[c] = (c >= ltl->birth_min && c <= ltl->birth_max) |
+                   (c >= ltl->survival_min && c <= ltl->survival_max) << 1;
+    }
+
+    memset(sums - GOL_LTL_MAX_RANGE, 0, sizeof(uint16_t) * size);
+    _gol_band_rows(game, first, last, band, count, &begin, &end);
+
+    for (j=begin; j < end; j += GOL_TILE_ROWS) {
+        uint8_t* tiles = game->tiles + (size_t) (j / GOL_TILE_ROWS) * game->tiles_x;
+        uint32_t bottom = j + GOL_TILE_ROWS < end ? j + GOL_TILE_ROWS : end;
+        uint32_t t, i;
+
+        for (t=0; t < game->tiles_x && !(tiles[t] & GOL_TILE_ACTIVE); t++);
+        if (t == game->tiles_x) continue;
+
+        for (i=j; i < bottom; i++) {
+            const uint64_t* row = game->cells + (size_t) i * game->pitch;
+            uint64_t* out = game->prev_cells + (size_t) i * game->pitch;
+            int64_t d;
+
+            /* The sums of the last row move down by a row. */
+            if (i == slide) {
+                _gol_ltl_add_row(game, sums, (int64_t) i + range, 1);
+                _gol_ltl_add_row(game, sums, (int64_t) i - range - 1, -1);
+            }
+            else {
+                memset(sums, 0, sizeof(uint16_t) * width);
+                for (d=-range; d <= range; d++) {
+                    _gol_ltl_add_row(game, sums, (int64_t) i + d, 1);
+                }
+            }
+            slide = i + 1;
+            if (game->adjacency) {
+                for (x=1; x <= range; x++) {
+                    sums[-x] = sums[_casemod(-x, width)];
+                    sums[width - 1 + x] = sums[_casemod(width - 1 + x, width)];
+                }
+            }
+
+            uint32_t w = 0;
+            while (w < game->tiles_x) {
+                if (!(tiles[w] & GOL_TILE_ACTIVE)) {
+                    w++;
+                    continue;
+                }
+                uint32_t run = w;
+                while (w < game->tiles_x && (tiles[w] & GOL_TILE_ACTIVE)) w++;
+
+                int32_t column = run * 64;
+                uint32_t sum = 0;
+                for (x=column - range; x <= column + range; x++) sum += sums[x];
+
+                uint32_t k;
+                for (k=run; k < w; k++) {
+                    int32_t stop = width - (int32_t) k * 64;
+                    uint64_t cells = row[k];
+                    uint64_t next = 0;
+                    int32_t b;
+                    if (stop > 64) stop = 64;
+                    for (b=0; b < stop; b++) {
+                        uint32_t cell = (cells >> b) & 1;
+                        uint32_t neighbours = sum - (ltl->middle ? 0 : cell);
+                        next |= (uint64_t) ((table[neighbours] >> cell) & 1) << b;
+                        x = k * 64 + b;
+                        sum += sums[x + range + 1] - sums[x - range];
+                    }
+                    out[k] = next;
+                }
+                _gol_record_words(game, i, out, row, run, w, false);
+            }
+        }
+    }
+}
+
+static void _gol_step_band(
+        const game_of_life_t* game, uint32_t first, uint32_t last,
+        uint32_t band, uint32_t count) {
+    if (game->tile_ltl.range) {
+        _gol_step_ltl_band(game, first, last, band, count);
+        return;
+    }
+#ifdef GOL_KERNEL_X86
+    if (__builtin_cpu_supports("popcnt")) {
+        _gol_step_band_popcnt(game, first, last, band, count);
+        return;
+    }
+#endif
+    _gol_step_rows(game, first, last, band, count, false);
+}
+
+/* Fills the halo around the rows [begin, end) of the grid of the current
+ * generation and the rows next to them, which the kernels read as the
+ * neighbours of the outer cells: with the cells of the opposite edges if
+ * adjacency is enabled, or with zeros. The unused bits set by
+ * :func:`gol_kernel_fill_row_halo` are cleared by :func:`_gol_clear_halo`
+ * once the rows are calculated. */
+static void _gol_fill_halo(
+        const game_of_life_t* game, uint32_t begin, uint32_t end) {
+    uint64_t* cells = game->cells;
+    uint32_t pitch = game->pitch;
+    uint32_t height = game->height;
+    uint32_t first = begin > 0 ? begin - 1 : 0;
+    uint32_t last = end < height ? end + 1 : height;
+    uint32_t y;
+
+    for (y=first; y < last; y++) {
+        gol_kernel_fill_row_halo(game, cells + (size_t) y * pitch);
+    }
+
+    if (begin == 0) {
+        if (game->adjacency) {
+            gol_kernel_fill_row_halo(game, cells + (size_t) (height - 1) * pitch);
+            memcpy(cells - pitch - 1, cells + (size_t) (height - 1) * pitch - 1,
+                   sizeof(uint64_t) * pitch);
+        }
+        else {
+            memset(cells - pitch - 1, 0, sizeof(uint64_t) * pitch);
+        }
+    }
+    if (end == height) {
+        if (game->adjacency) {
+            gol_kernel_fill_row_halo(game, cells);
+            memcpy(cells + (size_t) height * pitch - 1, cells - 1,
+                   sizeof(uint64_t) * pitch);
+        }
+        else {
+            memset(cells + (size_t) height * pitch - 1, 0, sizeof(uint64_t) * pitch);
+        }
+    }
+}
+
+/* Clears the unused bits of the grid that :func:`_gol_fill_halo` set for
+ * the rows [begin, end). */
+static void _gol_clear_halo(
+        const game_of_life_t* game, uint32_t begin, uint32_t end) {
+    uint64_t tail_mask = gol_kernel_tail_mask(game->width);
+    uint64_t* cells = game->cells + game->stride - 1;
+    uint32_t pitch = game->pitch;
+    uint32_t height = game->height;
+    uint32_t first = begin > 0 ? begin - 1 : 0;
+    uint32_t last = end < height ? end + 1 : height;
+    uint32_t y;
+
+    if (!game->adjacency || game->width % 64 == 0) return;
+    for (y=first; y < last; y++) {
+        cells[(size_t) y * pitch] &= tail_mask;
+    }
+    if (begin == 0) cells[(size_t) (height - 1) * pitch] &= tail_mask;
+    if (end == height) cells[0] &= tail_mask;
+}
+
+/* Pool task writing to the pages of both grids in the band of the thread,
+ * so that a system with several NUMA nodes places those which were not
+ * written yet in the memory of the node that the thread runs on. Pages
+ * shared with the next band are written by both threads, the first one
+ * places them. */
+static void _gol_touch_task(void* arg, uint32_t index, uint32_t count) {
+    const game_of_life_t* game = arg;
+    uint32_t begin, end;
+    _gol_band_rows(game, 0, game->tiles_y, index, count, &begin, &end);
+    int64_t first = (index == 0) ? -1 : (int64_t) begin;
+    int64_t last = (index + 1 == count) ? (int64_t) game->height + 1 : (int64_t) end;
+    size_t words = (size_t) (last - first) * game->pitch;
+    _gol_touch(game->cells + first * game->pitch - 1, words);
+    _gol_touch(game->prev_cells + first * game->pitch - 1, words);
+}
+
+/* Arguments of :func:`_gol_step_task`. */
+typedef struct _gol_slice {
+    const game_of_life_t* game;
+
+    /* The rows of tiles that are calculated. */
+    uint32_t first;
+    uint32_t last;
+} gol_slice_t;
+
+/* Pool task calculating the band of the thread of a slice of the rows. */
+static void _gol_step_task(void* arg, uint32_t index, uint32_t count) {
+    const gol_slice_t* slice = arg;
+    _gol_step_band(slice->game, slice->first, slice->last, index, count);
+}
+
+/* Compiles the rule if it changed since the last step. A change of the rule
+ * invalidates what we know about the tiles and the past generations. */
+static void _gol_sync_rule(game_of_life_t* game) {
+    if (game->rule.birth != game->tile_rule.birth ||
+            game->rule.survival != game->tile_rule.survival ||
+            !gol_ltl_rule_equal(game->ltl, game->tile_ltl)) {
+        game->tile_rule = game->rule;
+        game->tile_ltl = game->ltl;
+        gol_rule_compile(game->rule, &game->compiled_rule);
+        game_of_life_wake(game);
+        _gol_history_reset(game);
+    }
+}
+
+/* Marks the tiles that changed in the last generation or are adjacent to
+ * such a tile as active. */
+static void _gol_activate_tiles(game_of_life_t* game) {
+    uint32_t tx = game->tiles_x;
+    uint32_t ty = game->tiles_y;
+    uint8_t* tiles = game->tiles;
+    uint32_t i, j;
+
+    _gol_sync_rule(game);
+
+    /* A Larger than Life neighbourhood that wraps around the edges reaches
+     * across the last tile if it is narrower than the range. */
+    int reach_x = 1, reach_y = 1;
+    uint32_t range = game->tile_ltl.range;
+    if (game->adjacency && range) {
+        if (game->width % 64 && game->width % 64 < range) reach_x = 2;
+        if (game->height % GOL_TILE_ROWS && game->height % GOL_TILE_ROWS < range) {
+            reach_y = 2;
+        }
+    }
+
+    for (j=0; j < ty; j++) {
+        for (i=0; i < tx; i++) {
+            if (!(tiles[i + j * tx] & GOL_TILE_CHANGED)) continue;
+            int dx, dy;
+            for (dy=-reach_y; dy <= reach_y; dy++) {
+                for (dx=-reach_x; dx <= reach_x; dx++) {
+                    int64_t x = (int64_t) i + dx;
+                    int64_t y = (int64_t) j + dy;
+                    if (game->adjacency) {
+                        x = (x + tx) % tx;
+                        y = (y + ty) % ty;
+                    }
+                    else if (x < 0 || y < 0 || x >= tx || y >= ty) {
+                        continue;
+                    }
+                    tiles[x + y * tx] |= GOL_TILE_ACTIVE;
+                }
+            }
+        }
+    }
+}
+
+/* Records the hash of the new generation and looks for an earlier
+ * generation with the same hash. *before* is the hash of the board before
+ * the step. */
+static void _gol_track_cycle(game_of_life_t* game, uint64_t before) {
+    uint64_t hash = game_of_life_hash(game);
+    uint32_t age;
+
+    /* The history only describes the board if it was not edited since the
+     * last step. */
+    if (game->history_count > 0) {
+        uint32_t last = _gol_history_index(game, 1);
+        if (game->history[last].generation + 1 != game->generation ||
+                game->history[last].hash != before) {
+            _gol_history_reset(game);
+        }
+    }
+    if (game->history_count == 0) {
+        _gol_history_push(game, game->generation - 1, before);
+    }
+
+    /* A cycle lasts as long as the board does not change. */
+    if (game->period) {
+        uint32_t index = _gol_history_index(game, game->period);
+        if (game->history[index].hash != hash) game->period = 0;
+    }
+
+    if (!game->period) {
+        for (age=1; age <= game->history_count; age++) {
+            if (game->history[_gol_history_index(game, age)].hash == hash) break;
+        }
+        if (age > game->history_count) {
+            game->candidate = 0;
+        }
+        else if (age != game->candidate) {
+            game->candidate = age;
+            game->candidate_since = game->generation;
+        }
+        else if (game->generation - game->candidate_since >= age) {
+            game->period = age;
+        }
+    }
+
+    _gol_history_push(game, game->generation, hash);
+}
+
+/* Returns true if row *y* has a living cell in one of the words [first,
+ * last] whose tiles have living cells. */
+static bool _gol_row_alive(
+        const game_of_life_t* game, uint32_t y, uint32_t first, uint32_t last) {
+    const uint64_t* row = game_of_life_row(game, y);
+    const uint32_t* population = game->tile_population +
+            (size_t) (y / GOL_TILE_ROWS) * game->tiles_x;
+    uint32_t i;
+    for (i=first; i <= last; i++) {
+        if (population[i] && row[i]) return true;
+    }
+    return false;
+}
+
+/* Returns the bitwise or of the words of column *i* in the rows [first,
+ * last], reading only the tiles with living cells. */
+static uint64_t _gol_column_bits(
+        const game_of_life_t* game, uint32_t i, uint32_t first, uint32_t last) {
+    uint64_t bits = 0;
+    uint32_t y;
+    for (y=first; y <= last; y++) {
+        if (y % GOL_TILE_ROWS == 0 || y == first) {
+            size_t tile = (size_t) (y / GOL_TILE_ROWS) * game->tiles_x + i;
+            if (game->tile_population[tile] == 0) {
+                y |= GOL_TILE_ROWS - 1;
+                continue;
+            }
+        }
+        bits |= game_of_life_row(game, y)[i];
+    }
+    return bits;
+}
+
+/* Finds the bounding box of the living cells, which lie in the tiles
+ * [min_tx, max_tx] x [min_ty, max_ty]. Only the words of the outermost
+ * tiles are read. */
+static void _gol_bounding_box(
+        const game_of_life_t* game, gol_stats_t* stats, uint32_t min_tx,
+        uint32_t max_tx, uint32_t min_ty, uint32_t max_ty) {
+    uint32_t y;
+
+    stats->min_x = stats->min_y = stats->max_x = stats->max_y = 0;
+    if (min_tx > max_tx) return;
+
+    /* The first and last rows with a living cell. */
+    y = min_ty * GOL_TILE_ROWS;
+    while (!_gol_row_alive(game, y, min_tx, max_tx)) y++;
+    stats->min_y = y;
+    y = (max_ty + 1) * GOL_TILE_ROWS;
+    if (y > game->height) y = game->height;
+    while (!_gol_row_alive(game, --y, min_tx, max_tx));
+    stats->max_y = y;
+
+    /* The first and last columns with a living cell. */
+    uint64_t west = _gol_column_bits(game, min_tx, stats->min_y, stats->max_y);
+    uint64_t east = _gol_column_bits(game, max_tx, stats->min_y, stats->max_y);
+    stats->min_x = min_tx * 64 + __builtin_ctzll(west);
+    stats->max_x = max_tx * 64 + 63 - __builtin_clzll(east);
+}
+
+/* Starts a step: marks the tiles to calculate and remembers the hash of
+ * the board, which the step does not change until it completes. */
+static void _gol_step_begin(game_of_life_t* game) {
+    _gol_activate_tiles(game);
+    game->step_hash = game_of_life_hash(game);
+    game->step_row = 0;
+    game->step_time = 0;
+    game->stepping = true;
+}
+
+/* Calculates the rows of tiles [first, last) of the next generation. */
+static void _gol_step_slice(game_of_life_t* game, uint32_t first, uint32_t last) {
+    gol_slice_t slice = {game, first, last};
+    uint32_t begin = first * GOL_TILE_ROWS;
+    uint32_t end = last * GOL_TILE_ROWS < game->height
+                 ? last * GOL_TILE_ROWS : game->height;
+
+    if (!game->tile_ltl.range) _gol_fill_halo(game, begin, end);
+    if (game->pool) {
+        gol_pool_run(game->pool, _gol_step_task, &slice);
+    }
+    else {
+        _gol_step_task(&slice, 0, 1);
+    }
+    if (!game->tile_ltl.range) _gol_clear_halo(game, begin, end);
+}
+
+/* Completes a step once all rows are calculated. */
+static void _gol_step_finish(game_of_life_t* game) {
+    game->stepping = false;
     game->generation++;
-    int i, j;
-
-    /* Extract the rules into the local scope, for easier access and
-     * sped up computation. */
-    int keep_min = game->keep_cell.min;
-    int keep_max = game->keep_cell.max;
-    int make_min = game->make_cell.min;
-    int make_max = game->make_cell.max;
-
-    /* Iterate over the complete game cell and fill the "prev_state"
-     * attribute of each cell temporarily. This value will be moved
-     * to the "current" attribute later on. */
-    for (i=0; i < game->width; i++) {
-        for (j=0; j < game->height; j++) {
-            cell_t* cell = game_of_life_cell(game, i, j);
-
-            int neighbours = game_of_life_neighbour_count(game, i, j);
-            bool new_state;
-            if (cell->state) {
-                new_state = (neighbours >= keep_min &&
-                             neighbours <= keep_max);
+
+    /* The new generation becomes the current one. */
+    uint64_t* cells = game->cells;
+    game->cells = game->prev_cells;
+    game->prev_cells = cells;
+
+    /* The tiles that changed in this step are what the next step has
+     * to look at. Their hashes and counts are brought up to date and the
+     * statistics are gathered from the tiles on the way. */
+    gol_stats_t* stats = &game->stats;
+    uint32_t min_tx = game->tiles_x, max_tx = 0, min_ty = game->tiles_y, max_ty = 0;
+    uint32_t i, j;
+    size_t t;
+    stats->population = stats->births = stats->deaths = 0;
+    for (j=0, t=0; j < game->tiles_y; j++) {
+        for (i=0; i < game->tiles_x; i++, t++) {
+            if (game->tiles[t] & GOL_TILE_NEXT) {
+                game->tiles[t] = GOL_TILE_CHANGED;
+                game->tile_hash[t] ^= game->tile_next_hash[t];
+                game->tile_population[t] += game->tile_births[t] - game->tile_deaths[t];
+                stats->births += game->tile_births[t];
+                stats->deaths += game->tile_deaths[t];
+                game->tile_next_hash[t] = 0;
+                game->tile_births[t] = game->tile_deaths[t] = 0;
             }
             else {
-                new_state = (neighbours >= make_min &&
-                             neighbours <= make_max);
+                game->tiles[t] = 0;
             }
+            if (game->tile_population[t]) {
+                stats->population += game->tile_population[t];
+                if (i < min_tx) min_tx = i;
+                if (i > max_tx) max_tx = i;
+                if (j < min_ty) min_ty = j;
+                max_ty = j;
+            }
+        }
+    }
+    _gol_bounding_box(game, stats, min_tx, max_tx, min_ty, max_ty);
+
+    _gol_track_cycle(game, game->step_hash);
+    GOL_PROFILE_COUNT(GOL_COUNTER_GENERATIONS, 1);
+    GOL_PROFILE_COUNT(GOL_COUNTER_CELLS, (uint64_t) game->width * game->height);
+#ifndef GOL_NO_PROFILE
+    gol_profile_record(GOL_PHASE_STEP, game->step_time);
+#endif
+}
+
+void game_of_life_next_generation(game_of_life_t* game) {
+    game_of_life_step_partial(game, 0, 0);
+}
+
+bool game_of_life_step_partial(
+        game_of_life_t* game, uint32_t rows, uint64_t nanoseconds) {
+    GOL_PROFILE_BEGIN(step);
+    uint64_t start = nanoseconds ? gol_profile_clock() : 0;
+    uint32_t threads = game->pool ? gol_pool_size(game->pool) : 1;
+    if (!game->stepping) _gol_step_begin(game);
+
+    /* Without a time limit, the rows are calculated at once, otherwise a
+     * row of tiles for each thread at a time. */
+    uint32_t budget = game->tiles_y;
+    if (rows) budget = (rows + GOL_TILE_ROWS - 1) / GOL_TILE_ROWS;
+    while (game->step_row < game->tiles_y && budget > 0) {
+        uint32_t count = game->tiles_y - game->step_row;
+        if (count > budget) count = budget;
+        if (nanoseconds && count > threads) count = threads;
+        _gol_step_slice(game, game->step_row, game->step_row + count);
+        game->step_row += count;
+        budget -= count;
+        if (nanoseconds && gol_profile_clock() - start >= nanoseconds) break;
+    }
+
+#ifndef GOL_NO_PROFILE
+    game->step_time += gol_profile_clock() - step;
+#endif
+    if (game->step_row < game->tiles_y) return false;
+    _gol_step_finish(game);
+    return true;
+}
 
-            /* Temporarily fill the "prev_state" attribute. */
-            cell->prev_state = new_state;
+void game_of_life_step_cancel(game_of_life_t* game) {
+    uint32_t end = game->step_row * GOL_TILE_ROWS;
+    uint32_t i, y;
+    size_t t;
+    if (!game->stepping) return;
+    if (end > game->height) end = game->height;
+
+    /* The calculated tiles are set back to the current generation, so that
+     * both grids hold the same cells in the tiles that the next step does
+     * not calculate. Only the flags that the step set are cleared. */
+    for (y=0; y < end; y++) {
+        const uint8_t* tiles = game->tiles + (size_t) (y / GOL_TILE_ROWS) * game->tiles_x;
+        const uint64_t* row = game->cells + (size_t) y * game->pitch;
+        uint64_t* prev = game->prev_cells + (size_t) y * game->pitch;
+        for (i=0; i < game->tiles_x; i++) {
+            if (tiles[i] & GOL_TILE_ACTIVE) prev[i] = row[i];
         }
     }
+    for (t=0; t < (size_t) game->tiles_x * game->tiles_y; t++) {
+        game->tiles[t] &= ~(GOL_TILE_ACTIVE | GOL_TILE_NEXT);
+        game->tile_next_hash[t] = 0;
+        game->tile_births[t] = game->tile_deaths[t] = 0;
+    }
+    game->stepping = false;
+}
 
-    /* Update the states of each cell. */
-    for (i=0; i < game->width; i++) {
-        for (j=0; j < game->height; j++) {
-            cell_t* cell = game_of_life_cell(game, i, j);
+uint64_t game_of_life_population(const game_of_life_t* game) {
+    size_t tile_count = (size_t) game->tiles_x * game->tiles_y;
+    uint64_t population = 0;
+    size_t t;
+    for (t=0; t < tile_count; t++) population += game->tile_population[t];
+    return population;
+}
+
+uint64_t game_of_life_hash(const game_of_life_t* game) {
+    size_t tile_count = (size_t) game->tiles_x * game->tiles_y;
+    uint64_t hash = 0;
+    size_t t;
+    for (t=0; t < tile_count; t++) hash ^= game->tile_hash[t];
+    return hash;
+}
 
-            bool value = cell->prev_state;
-            cell->prev_state = cell->state;
-            cell->state = value;
+/* Returns true if the cycle found by the last step still describes the
+ * board: it was neither edited nor restored and the rule did not change
+ * since, which the next step would only notice. */
+static bool _gol_cycle_current(const game_of_life_t* game) {
+    if (!game->period || game->history_count == 0) return false;
+    uint32_t last = _gol_history_index(game, 1);
+    return game->history[last].generation == game->generation &&
+           game->history[last].hash == game_of_life_hash(game) &&
+           game->rule.birth == game->tile_rule.birth &&
+           game->rule.survival == game->tile_rule.survival &&
+           gol_ltl_rule_equal(game->ltl, game->tile_ltl);
+}
+
+bool game_of_life_fast_forward(game_of_life_t* game, uint64_t generation) {
+    if (generation < game->generation) return false;
+    while (game->generation < generation) {
+        if (_gol_cycle_current(game)) {
+            /* The board is the same a whole number of periods later, and
+             * so is the history. */
+            uint64_t skip = (generation - game->generation) / game->period *
+                            game->period;
+            uint32_t i;
+            for (i=0; i < GOL_HISTORY; i++) game->history[i].generation += skip;
+            game->candidate_since += skip;
+            game->generation += skip;
+            if (game->generation == generation) break;
+        }
+        game_of_life_next_generation(game);
+    }
+    return true;
+}
+
+/* Arguments of :func:`gol_block_task`. */
+typedef struct _gol_block {
+    game_of_life_t* game;
+
+    /* The number of generations calculated in this pass. */
+    uint32_t depth;
+
+    /* The grid is calculated in bands of *band_rows* rows. */
+    uint32_t band_rows;
+    uint32_t bands;
+
+    /* Two buffers of *buffer_rows* rows for every thread. */
+    uint64_t* buffers;
+    uint32_t buffer_rows;
+} gol_block_t;
+
+/* Calculates *depth* generations of a band of rows in the buffers of a
+ * thread and writes them into the grid of the previous generation. The
+ * band is loaded with *depth* rows above and below it; with every
+ * generation one of these rows on either side becomes invalid, so that
+ * the rows of the band itself are valid after the last one. */
+static void _gol_block_band(
+        const gol_block_t* block, uint32_t band, uint64_t* buffers[2]) {
+    const game_of_life_t* game = block->game;
+    uint32_t pitch = game->pitch;
+    uint32_t stride = game->stride;
+    int64_t height = game->height;
+    int64_t first = (int64_t) band * block->band_rows;
+    int64_t last = first + block->band_rows < height
+                 ? first + block->band_rows : height;
+    uint32_t depth = block->depth;
+    uint32_t rows = (uint32_t) (last - first) + 2 * depth;
+    uint32_t j, s;
+
+    /* Load the band and the rows around it. Rows outside of a grid without
+     * adjacency are dead and stay dead. */
+    for (j=0; j < rows; j++) {
+        int64_t y = first - depth + j;
+        uint64_t* row = buffers[0] + (size_t) j * pitch + 1;
+        if (game->adjacency) {
+            y = ((y % height) + height) % height;
+        }
+        else if (y < 0 || y >= height) {
+            memset(row - 1, 0, sizeof(uint64_t) * pitch);
+            memset(buffers[1] + (size_t) j * pitch, 0, sizeof(uint64_t) * pitch);
+            continue;
         }
+        memcpy(row, game->cells + (size_t) y * pitch, sizeof(uint64_t) * stride);
     }
+
+    for (s=1; s <= depth; s++) {
+        uint64_t* src = buffers[(s - 1) & 1] + 1;
+        uint64_t* dst = buffers[s & 1] + 1;
+        for (j=s - 1; j < rows - s + 1; j++) {
+            gol_kernel_fill_row_halo(game, src + (size_t) j * pitch);
+        }
+        for (j=s; j < rows - s; j++) {
+            int64_t y = first - depth + j;
+            if (!game->adjacency && (y < 0 || y >= height)) continue;
+            const uint64_t* row = src + (size_t) j * pitch;
+            game->row_kernel(game, dst + (size_t) j * pitch, row - pitch, row,
+                             row + pitch, 0, stride);
+        }
+    }
+
+    const uint64_t* result = buffers[depth & 1] + 1 + (size_t) depth * pitch;
+    for (j=0; j < last - first; j++) {
+        memcpy(game->prev_cells + (size_t) (first + j) * pitch,
+               result + (size_t) j * pitch, sizeof(uint64_t) * stride);
+    }
+}
+
+/* Pool task calculating every *count*-th band of a pass. */
+static void gol_block_task(void* arg, uint32_t index, uint32_t count) {
+    const gol_block_t* block = arg;
+    size_t size = (size_t) block->buffer_rows * block->game->pitch;
+    uint64_t* buffers[2] = {
+        block->buffers + size * 2 * index,
+        block->buffers + size * (2 * index + 1),
+    };
+    uint32_t band;
+    for (band=index; band < block->bands; band += count) {
+        _gol_block_band(block, band, buffers);
+    }
+}
+
+/* Calculates *n* generations in passes of up to GOL_BLOCK_DEPTH generations,
+ * each of which reads and writes the grid once. Returns false if the
+ * buffers could not be allocated. */
+static bool _gol_advance_blocked(game_of_life_t* game, uint64_t n) {
+    gol_block_t block;
+    uint32_t threads = game->pool ? gol_pool_size(game->pool) : 1;
+    size_t row_bytes = sizeof(uint64_t) * game->pitch;
+
+    /* Size the bands so that the two buffers of a thread fit into its
+     * share of the cache. */
+    size_t band_rows = GOL_BLOCK_BYTES / (2 * row_bytes);
+    band_rows = band_rows > 2 * GOL_BLOCK_DEPTH
+              ? band_rows - 2 * GOL_BLOCK_DEPTH : 0;
+    if (band_rows < GOL_TILE_ROWS) band_rows = GOL_TILE_ROWS;
+    if (band_rows > game->height) band_rows = game->height;
+
+    block.game = game;
+    block.band_rows = band_rows;
+    block.bands = (game->height + band_rows - 1) / band_rows;
+    block.buffer_rows = band_rows + 2 * GOL_BLOCK_DEPTH;
+    block.buffers = malloc(row_bytes * block.buffer_rows * 2 * threads);
+    if (block.buffers == NULL) return false;
+
+    while (n > 0) {
+        block.depth = n < GOL_BLOCK_DEPTH ? (uint32_t) n : GOL_BLOCK_DEPTH;
+        if (game->pool) {
+            gol_pool_run(game->pool, gol_block_task, &block);
+        }
+        else {
+            gol_block_task(&block, 0, 1);
+        }
+
+        uint64_t* cells = game->cells;
+        game->cells = game->prev_cells;
+        game->prev_cells = cells;
+        game->generation += block.depth;
+        n -= block.depth;
+    }
+
+    free(block.buffers);
+    return true;
+}
+
+void game_of_life_advance(game_of_life_t* game, uint64_t n) {
+    size_t tile_count = (size_t) game->tiles_x * game->tiles_y;
+    size_t changed = 0;
+    size_t t;
+    if (n == 0) return;
+    if (game->stepping) {
+        game_of_life_next_generation(game);
+        if (--n == 0) return;
+    }
+
+    /* Boards where little happens are faster to step one generation at a
+     * time, as that skips the tiles which don't change. */
+    for (t=0; t < tile_count; t++) {
+        if (game->tiles[t] & GOL_TILE_CHANGED) changed++;
+    }
+
+    _gol_sync_rule(game);
+    if (n > 1 && changed * 4 >= tile_count && !game->tile_ltl.range &&
+            _gol_advance_blocked(game, n - 1)) {
+        GOL_PROFILE_COUNT(GOL_COUNTER_GENERATIONS, n - 1);
+        GOL_PROFILE_COUNT(GOL_COUNTER_CELLS, (n - 1) * game->width * game->height);
+        game_of_life_wake(game);
+        n = 1;
+    }
+
+    /* The last generation is stepped on its own, which leaves the grid of
+     * the previous generation and the flags of the tiles as they would be
+     * after single steps. */
+    while (n-- > 0) {
+        game_of_life_next_generation(game);
+    }
+}
+
+/* The header at the start of a snapshot file. */
+typedef struct gol_snapshot_header {
+    char magic[8];
+    uint32_t version;
+
+    /* GOL_SNAPSHOT_BYTE_ORDER as written by the machine, to detect a file
+     * of a machine with a different byte order. */
+    uint32_t byte_order;
+
+    uint32_t width;
+    uint32_t height;
+    uint64_t generation;
+    uint32_t adjacency;
+    uint16_t birth;
+    uint16_t survival;
+
+    /* The Larger than Life rule, all zero if the game has none. */
+    uint32_t ltl_range;
+    uint32_t ltl_middle;
+    uint32_t ltl_birth_min;
+    uint32_t ltl_birth_max;
+    uint32_t ltl_survival_min;
+    uint32_t ltl_survival_max;
+
+    gol_stats_t stats;
+} gol_snapshot_header_t;
+
+/* The offsets of the sections of a snapshot file. The tile flags, hashes
+ * and populations follow the header, then comes the grid at an offset of
+ * a multiple of GOL_SNAPSHOT_ALIGN, with its halo words and rows. */
+typedef struct gol_snapshot_layout {
+    size_t tiles;
+    size_t tile_hash;
+    size_t tile_population;
+    size_t grid;
+    size_t size;
+} gol_snapshot_layout_t;
+
+/* Calculates the layout of the snapshot of a game of the specified size. */
+static void _gol_snapshot_layout(
+        uint32_t width, uint32_t height, gol_snapshot_layout_t* layout) {
+    size_t stride = (width + 63) / 64;
+    size_t tile_count = stride * ((height + GOL_TILE_ROWS - 1) / GOL_TILE_ROWS);
+    layout->tiles = sizeof(gol_snapshot_header_t);
+    layout->tile_hash = _gol_align(layout->tiles + tile_count, sizeof(uint64_t));
+    layout->tile_population = layout->tile_hash + sizeof(uint64_t) * tile_count;
+    layout->grid = _gol_align(
+        layout->tile_population + sizeof(uint32_t) * tile_count,
+        GOL_SNAPSHOT_ALIGN);
+    layout->size = layout->grid +
+        sizeof(uint64_t) * (stride + 2) * ((size_t) height + 2);
+}
+
+/* Writes *size* zero bytes to the file. */
+static bool _gol_write_zeros(FILE* fp, size_t size) {
+    static const uint64_t zeros[64];
+    while (size > 0) {
+        size_t count = size < sizeof(zeros) ? size : sizeof(zeros);
+        if (fwrite(zeros, 1, count, fp) != count) return false;
+        size -= count;
+    }
+    return true;
+}
+
+/* Writes the sections of a snapshot, see :func:`game_of_life_save`. */
+static bool _gol_snapshot_write(const game_of_life_t* game, FILE* fp) {
+    gol_snapshot_header_t header;
+    gol_snapshot_layout_t layout;
+    size_t tile_count = (size_t) game->tiles_x * game->tiles_y;
+    size_t row_bytes = sizeof(uint64_t) * game->stride;
+    uint32_t y;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, GOL_SNAPSHOT_MAGIC, sizeof(GOL_SNAPSHOT_MAGIC));
+    header.version = GOL_SNAPSHOT_VERSION;
+    header.byte_order = GOL_SNAPSHOT_BYTE_ORDER;
+    header.width = game->width;
+    header.height = game->height;
+    header.generation = game->generation;
+    header.adjacency = game->adjacency;
+    header.birth = game->rule.birth;
+    header.survival = game->rule.survival;
+    header.ltl_range = game->ltl.range;
+    header.ltl_middle = game->ltl.middle;
+    header.ltl_birth_min = game->ltl.birth_min;
+    header.ltl_birth_max = game->ltl.birth_max;
+    header.ltl_survival_min = game->ltl.survival_min;
+    header.ltl_survival_max = game->ltl.survival_max;
+    header.stats = game->stats;
+    _gol_snapshot_layout(game->width, game->height, &layout);
+
+    size_t end = layout.tiles + tile_count;
+    if (fwrite(&header, sizeof(header), 1, fp) != 1 ||
+            fwrite(game->tiles, 1, tile_count, fp) != tile_count ||
+            !_gol_write_zeros(fp, layout.tile_hash - end) ||
+            fwrite(game->tile_hash, sizeof(uint64_t), tile_count, fp) != tile_count ||
+            fwrite(game->tile_population, sizeof(uint32_t), tile_count, fp) != tile_count) {
+        return false;
+    }
+    end = layout.tile_population + sizeof(uint32_t) * tile_count;
+    if (!_gol_write_zeros(fp, layout.grid - end)) return false;
+
+    /* The halos of the grid are written as zeros, whatever the last step
+     * left in them. */
+    if (!_gol_write_zeros(fp, sizeof(uint64_t) * (game->pitch + 1))) return false;
+    for (y=0; y < game->height; y++) {
+        const uint64_t* row = game_of_life_row(game, y);
+        if (fwrite(row, 1, row_bytes, fp) != row_bytes ||
+                !_gol_write_zeros(fp, sizeof(uint64_t) * 2)) {
+            return false;
+        }
+    }
+    return _gol_write_zeros(fp, sizeof(uint64_t) * (game->pitch - 1));
+}
+
+bool game_of_life_save(const game_of_life_t* game, const char* filename) {
+    FILE* fp = fopen(filename, "wb");
+    if (fp == NULL) return false;
+    GOL_PROFILE_BEGIN(start);
+    bool success = _gol_snapshot_write(game, fp);
+    long size = ftell(fp);
+    if (fclose(fp) != 0) success = false;
+    if (success && size > 0) GOL_PROFILE_COUNT(GOL_COUNTER_BYTES, size);
+    GOL_PROFILE_END(start, GOL_PHASE_IO);
+    return success;
+}
+
+/* Returns true if the header describes a snapshot that this version can
+ * load and that fits into a file of *size* bytes. */
+static bool _gol_snapshot_valid(
+        const gol_snapshot_header_t* header, size_t size) {
+    gol_snapshot_layout_t layout;
+    if (memcmp(header->magic, GOL_SNAPSHOT_MAGIC, sizeof(header->magic)) != 0) {
+        return false;
+    }
+    if (header->version != GOL_SNAPSHOT_VERSION) return false;
+    if (header->byte_order != GOL_SNAPSHOT_BYTE_ORDER) return false;
+    if (header->width < 1 || header->height < 1) return false;
+    if (header->birth > 0x1ff || header->survival > 0x1ff) return false;
+    if (header->ltl_range > GOL_LTL_MAX_RANGE || header->ltl_middle > 1) {
+        return false;
+    }
+    _gol_snapshot_layout(header->width, header->height, &layout);
+    return layout.size <= size;
+}
+
+game_of_life_t* game_of_life_load(const char* filename) {
+    struct stat info;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+    if (fstat(fd, &info) != 0 ||
+            (size_t) info.st_size < sizeof(gol_snapshot_header_t)) {
+        close(fd);
+        return NULL;
+    }
+
+    /* Both grids are mapped from the file, so that the tiles which are not
+     * calculated in the next step already hold the same cells in both. */
+    size_t size = info.st_size;
+    void* mappings[2];
+    mappings[0] = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    mappings[1] = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mappings[0] == MAP_FAILED || mappings[1] == MAP_FAILED) {
+        if (mappings[0] != MAP_FAILED) munmap(mappings[0], size);
+        if (mappings[1] != MAP_FAILED) munmap(mappings[1], size);
+        return NULL;
+    }
+
+    char* data = mappings[0];
+    gol_snapshot_header_t header;
+    memcpy(&header, data, sizeof(header));
+    game_of_life_t* game = NULL;
+    if (_gol_snapshot_valid(&header, size)) {
+        game = _gol_alloc(header.width, header.height, header.adjacency, false);
+    }
+    if (game == NULL) {
+        munmap(mappings[0], size);
+        munmap(mappings[1], size);
+        return NULL;
+    }
+
+    gol_snapshot_layout_t layout;
+    size_t tile_count = (size_t) game->tiles_x * game->tiles_y;
+    _gol_snapshot_layout(header.width, header.height, &layout);
+    memcpy(game->tiles, data + layout.tiles, tile_count);
+    memcpy(game->tile_hash, data + layout.tile_hash, sizeof(uint64_t) * tile_count);
+    memcpy(game->tile_population, data + layout.tile_population,
+           sizeof(uint32_t) * tile_count);
+
+    game->mappings[0] = mappings[0];
+    game->mappings[1] = mappings[1];
+    game->mapping_size = size;
+    game->cells = (uint64_t*) (data + layout.grid) + game->pitch + 1;
+    game->prev_cells = (uint64_t*) ((char*) mappings[1] + layout.grid) +
+                       game->pitch + 1;
+    game->generation = header.generation;
+    game->rule.birth = header.birth;
+    game->rule.survival = header.survival;
+    game->tile_rule = game->rule;
+    gol_rule_compile(game->rule, &game->compiled_rule);
+    game->ltl.range = header.ltl_range;
+    game->ltl.middle = header.ltl_middle;
+    game->ltl.birth_min = header.ltl_birth_min;
+    game->ltl.birth_max = header.ltl_birth_max;
+    game->ltl.survival_min = header.ltl_survival_min;
+    game->ltl.survival_max = header.ltl_survival_max;
+    game->tile_ltl = game->ltl;
+    if (!_gol_ltl_reserve(game, &game->ltl, game->threads)) {
+        game_of_life_destroy(game);
+        return NULL;
+    }
+    game->stats = header.stats;
+    return game;
+}
+
+bool game_of_life_set_rule(game_of_life_t* game, const char* rule) {
+    gol_rule_t life = game->rule;
+    gol_ltl_rule_t ltl;
+    memset(&ltl, 0, sizeof(ltl));
+    if (!gol_rule_parse(rule, &life) && !gol_ltl_rule_parse(rule, &ltl)) {
+        return false;
+    }
+
+    /* A step in progress calculates the rest of its rows with the rule
+     * and the column sums it started with. */
+    game_of_life_step_cancel(game);
+    if (!_gol_ltl_reserve(game, &ltl, game->threads)) return false;
+    game->rule = life;
+    game->ltl = ltl;
+    return true;
+}
+
+bool game_of_life_set_kernel(game_of_life_t* game, GOL_KERNEL kernel) {
+    if (kernel == GOL_KERNEL_AUTO) {
+        kernel = gol_kernel_detect();
+    }
+    game_of_life_row_kernel_t row_kernel = gol_kernel_lookup(kernel);
+    if (row_kernel == NULL) return false;
+    game->kernel = kernel;
+    game->row_kernel = row_kernel;
+    return true;
+}
+
+const char* game_of_life_kernel_name(GOL_KERNEL kernel) {
+    switch (kernel) {
+        case GOL_KERNEL_AUTO: return "auto";
+        case GOL_KERNEL_SCALAR: return "scalar";
+        case GOL_KERNEL_SSE2: return "sse2";
+        case GOL_KERNEL_AVX2: return "avx2";
+        case GOL_KERNEL_AVX512: return "avx512";
+    }
+    return "unknown";
+}
+
+bool game_of_life_set_threads(game_of_life_t* game, uint32_t threads) {
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0) ? (uint32_t) cpus : 1;
+    }
+    if (threads == game->threads) return true;
+
+    gol_pool_t* pool = NULL;
+    if (threads > 1) {
+        pool = gol_pool_create(threads);
+        if (pool == NULL) return false;
+    }
+    if (!_gol_ltl_reserve(game, &game->ltl, threads)) {
+        if (pool) gol_pool_destroy(pool);
+        return false;
+    }
+
+    if (game->pool) gol_pool_destroy(game->pool);
+    game->pool = pool;
+    game->threads = threads;
+
+    /* The pages of a snapshot are only copied when they are written. */
+    if (pool && game->mappings[0] == NULL) {
+        gol_pool_run(pool, _gol_touch_task, game);
+    }
+    return true;
 }
 
 void game_of_life_draw_block(
         const game_of_life_t* game, int32_t x, int32_t y, int32_t w, int32_t h,
         bool state) {
-    int i, j;
+    int j;
+    if (game->adjacency && h > (int64_t) game->height) h = game->height;
+    for (j=0; j < h; j++) {
+        game_of_life_draw_span(game, x, y + j, w, state);
+    }
+}
+
+/* Maps the cell *i*, *j* of a pattern of *w* x *h* cells, in the
+ * orientation of the grid, to the character *pi*, *pj* of the pattern and
+ * the offset *gi*, *gj* in the grid. */
+static void _gol_pattern_map(
+        int32_t i, int32_t j, int32_t w, int32_t h, GOL_ROT rotation,
+        GOL_FLIP flip, int32_t* pi, int32_t* pj, int32_t* gi, int32_t* gj) {
+    *pi = *gi = i;
+    *pj = *gj = j;
+
+    switch (rotation) {
+        case GOL_ROT_270:
+            *gi = *pj;
+            *gj = w - 1 - *pi;
+            break;
+        case GOL_ROT_180:
+            *pi = w - 1 - *pi;
+            *pj = h - 1 - *pj;
+            break;
+        case GOL_ROT_90:
+            *gi = h - 1 - *pj;
+            *gj = *pi;
+            break;
+        case GOL_ROT_0:
+        default:
+            break;
+    }
+
+    if (flip & GOL_FLIP_H) *pi = w - 1 - *pi;
+    if (flip & GOL_FLIP_V) *pj = h - 1 - *pj;
+}
+
+/* Sets the size of the bitmap of a pattern of *w* x *h* cells in the
+ * specified orientation. Returns the number of words of its rows. */
+static size_t _gol_bitmap_size(
+        gol_bitmap_t* bitmap, int32_t w, int32_t h, GOL_ROT rotation) {
+    bool turned = (rotation == GOL_ROT_90 || rotation == GOL_ROT_270);
+    bitmap->width = turned ? h : w;
+    bitmap->height = turned ? w : h;
+
+    /* The extra word lets :func:`_gol_bitmap_bits` read past the end of a
+     * row. */
+    bitmap->stride = (bitmap->width + 63) / 64 + 1;
+    return (size_t) bitmap->stride * bitmap->height;
+}
+
+/* Fills the zeroed rows of a bitmap, sized by :func:`_gol_bitmap_size`,
+ * with the living cells of the pattern. */
+static void _gol_bitmap_build(
+        gol_bitmap_t* bitmap, const char* pattern, int32_t w, int32_t h,
+        GOL_ROT rotation, GOL_FLIP flip) {
+    int32_t i, j, pi, pj, gi, gj;
     for (i=0; i < w; i++) {
         for (j=0; j < h; j++) {
-            game_of_life_cell_set(game, x + i, y + j, state);
+            _gol_pattern_map(i, j, w, h, rotation, flip, &pi, &pj, &gi, &gj);
+            char c = pattern[pi + pj * w];
+            if (c == 'x' || c == 'X') {
+                bitmap->bits[(size_t) gj * bitmap->stride + gi / 64] |=
+                        (uint64_t) 1 << (gi % 64);
+            }
         }
     }
 }
 
+/* Returns the *len* bits of a bitmap row from bit *offset* on. */
+static inline uint64_t _gol_bitmap_bits(
+        const uint64_t* row, uint32_t offset, uint32_t len) {
+    uint64_t bits = row[offset / 64] >> (offset % 64);
+    if (offset % 64) bits |= row[offset / 64 + 1] << (64 - offset % 64);
+    return len < 64 ? bits & (((uint64_t) 1 << len) - 1) : bits;
+}
+
+/* Writes *n* cells of a bitmap row from bit *src* on into row *y* from
+ * column *dst* on, where they lie in the grid. Dead cells are only
+ * written if *reset* is true. */
+static void _gol_row_write(
+        const game_of_life_t* game, uint32_t y, uint32_t dst,
+        const uint64_t* row, uint32_t src, uint32_t n, bool reset) {
+    uint32_t end = dst + n;
+    while (dst < end) {
+        uint32_t shift = dst % 64;
+        uint32_t len = end - dst < 64 - shift ? end - dst : 64 - shift;
+        uint64_t value = _gol_bitmap_bits(row, src, len) << shift;
+        uint64_t mask = len < 64 ? (((uint64_t) 1 << len) - 1) << shift
+                                 : ~(uint64_t) 0;
+        _gol_word_write(game, y, dst / 64, reset ? mask : value, value);
+        dst += len;
+        src += len;
+    }
+}
+
+/* Stamps a bitmap into the grid with its top-left corner at *x*, *y*. Each
+ * row is split into the spans that lie in the grid, wrapping around the
+ * edges or clipped to them. */
+static void _gol_bitmap_stamp(
+        const game_of_life_t* game, const gol_bitmap_t* bitmap, int32_t x,
+        int32_t y, bool reset) {
+    int64_t width = game->width;
+    uint32_t j;
+
+    for (j=0; j < bitmap->height; j++) {
+        const uint64_t* row = bitmap->bits + (size_t) j * bitmap->stride;
+        int64_t gy = (int64_t) y + j;
+        int64_t gx = x;
+        uint32_t src = 0;
+        uint32_t n = bitmap->width;
+
+        if (game->adjacency) {
+            gy = _casemod(gy % game->height, game->height);
+            gx = _casemod(gx % width, width);
+            while (src < n) {
+                uint32_t len = n - src < width - gx ? n - src : width - gx;
+                _gol_row_write(game, gy, gx, row, src, len, reset);
+                src += len;
+                gx = 0;
+            }
+            continue;
+        }
+
+        if (gy < 0 || gy >= game->height || gx >= width) continue;
+        if (gx < 0) {
+            if (-gx >= n) continue;
+            src = -gx;
+            gx = 0;
+        }
+        if (n - src > width - gx) n = src + (width - gx);
+        _gol_row_write(game, gy, gx, row, src, n - src, reset);
+    }
+}
+
+game_of_life_pattern_t* game_of_life_pattern_compile(
+        const char* pattern, int32_t w, int32_t h) {
+    if (w < 1 || h < 1) return NULL;
+    game_of_life_pattern_t* compiled = malloc(sizeof(game_of_life_pattern_t));
+    if (compiled == NULL) return NULL;
+
+    size_t total = 0;
+    int r, f;
+    for (r=0; r < 4; r++) {
+        for (f=0; f < 4; f++) {
+            total += _gol_bitmap_size(&compiled->bitmaps[r][f], w, h, r);
+        }
+    }
+    compiled->bits = calloc(total, sizeof(uint64_t));
+    if (compiled->bits == NULL) {
+        free(compiled);
+        return NULL;
+    }
+
+    uint64_t* bits = compiled->bits;
+    for (r=0; r < 4; r++) {
+        for (f=0; f < 4; f++) {
+            gol_bitmap_t* bitmap = &compiled->bitmaps[r][f];
+            bitmap->bits = bits;
+            bits += (size_t) bitmap->stride * bitmap->height;
+            _gol_bitmap_build(bitmap, pattern, w, h, r, f);
+        }
+    }
+    compiled->width = w;
+    compiled->height = h;
+    return compiled;
+}
+
+void game_of_life_pattern_destroy(game_of_life_pattern_t* pattern) {
+    if (pattern) {
+        free(pattern->bits);
+        pattern->bits = NULL;
+        free(pattern);
+    }
+}
+
+void game_of_life_draw_compiled(
+        const game_of_life_t* game, const game_of_life_pattern_t* pattern,
+        int32_t x, int32_t y, GOL_ROT rotation, GOL_FLIP flip, bool reset) {
+    _gol_bitmap_stamp(game, &pattern->bitmaps[rotation & 3][flip & 3],
+                      x, y, reset);
+}
+
 void game_of_life_draw_pattern(
         const game_of_life_t* game, const char* pattern, int32_t x, int32_t y,
         int32_t w, int32_t h, GOL_ROT rotation, GOL_FLIP flip, bool reset) {
-    int i, j;
-    for (i=0; i < w; i++) {
-        for (j=0; j < h; j++) {
-            int pi = i;
-            int pj = j;
-            int gi = i;
-            int gj = j;
-
-            switch (rotation) {
-                case GOL_ROT_270:
-                    gi = pj;
-                    gj = w - 1 - pi;
-                    break;
-                case GOL_ROT_180:
-                    pi = w - 1 - pi;
-                    pj = h - 1 - pj;
-                    break;
-                case GOL_ROT_90:
-                    gi = h - 1 - pj;
-                    gj = pi;
-                    break;
-                case GOL_ROT_0:
-                default:
-                    break;
-            }
+    uint64_t buffer[256];
+    gol_bitmap_t bitmap;
+    if (w < 1 || h < 1) return;
+
+    /* Only the requested orientation is compiled, on the stack if it is
+     * small enough. */
+    size_t size = _gol_bitmap_size(&bitmap, w, h, rotation);
+    if (size <= sizeof(buffer) / sizeof(buffer[0])) {
+        memset(buffer, 0, sizeof(uint64_t) * size);
+        bitmap.bits = buffer;
+    }
+    else {
+        bitmap.bits = calloc(size, sizeof(uint64_t));
+        if (bitmap.bits == NULL) return;
+    }
+
+    _gol_bitmap_build(&bitmap, pattern, w, h, rotation, flip);
+    _gol_bitmap_stamp(game, &bitmap, x, y, reset);
+    if (bitmap.bits != buffer) free(bitmap.bits);
+}
 
-            if (flip & GOL_FLIP_H) pi = w - 1 - pi;
-            if (flip & GOL_FLIP_V) pj = h - 1 - pj;
+/* A built-in pattern, compiled when it is first drawn and kept for the
+ * lifetime of the process. */
+typedef struct _gol_builtin {
+    const char* pattern;
+    int32_t width;
+    int32_t height;
+    game_of_life_pattern_t* compiled;
+} gol_builtin_t;
 
-            char c = pattern[pi + pj * w];
-            bool living = (c == 'x' || c == 'X');
-            if (!reset && !living) continue;
-            game_of_life_cell_set(game, x + gi, y + gj, living);
+static gol_builtin_t gol_builtin_glider = {
+    " X "
+    "  X"
+    "XXX",
+    3, 3, NULL,
+};
+
+static gol_builtin_t gol_builtin_lwss = {
+    " XXXX"
+    "X   X"
+    "    X"
+    "X  X ",
+    5, 4, NULL,
+};
+
+static gol_builtin_t gol_builtin_glidergun = {
+    "                        X           "
+    "                      X X           "
+    "            XX      XX            XX"
+    "           X   X    XX            XX"
+    "XX        X     X   XX              "
+    "XX        X   X XX    X X           "
+    "          X     X       X           "
+    "           X   X                    "
+    "            XX                      ",
+    36, 9, NULL,
+};
+
+/* Draws a built-in pattern, compiling it on the first call. Threads that
+ * compile it at the same time keep the first one. If memory allocation
+ * fails, the pattern is drawn without being compiled. */
+static void _gol_builtin_draw(
+        gol_builtin_t* builtin, const game_of_life_t* game, int32_t x,
+        int32_t y, GOL_ROT rotation, GOL_FLIP flip) {
+    game_of_life_pattern_t* compiled =
+            __atomic_load_n(&builtin->compiled, __ATOMIC_ACQUIRE);
+    if (compiled == NULL) {
+        game_of_life_pattern_t* expected = NULL;
+        compiled = game_of_life_pattern_compile(
+                builtin->pattern, builtin->width, builtin->height);
+        if (compiled == NULL) {
+            game_of_life_draw_pattern(game, builtin->pattern, x, y, builtin->width,
+                                      builtin->height, rotation, flip, true);
+            return;
+        }
+        if (!__atomic_compare_exchange_n(&builtin->compiled, &expected, compiled,
+                                         false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            game_of_life_pattern_destroy(compiled);
+            compiled = expected;
         }
     }
+    game_of_life_draw_compiled(game, compiled, x, y, rotation, flip, true);
 }
 
 void game_of_life_draw_glider(
         const game_of_life_t* game, int32_t x, int32_t y, GOL_ROT rotation,
         GOL_FLIP flip) {
-    static const int w = 3;
-    static const int h = 3;
-    static const char pattern[] =
-            " X "
-            "  X"
-            "XXX";
-
-    game_of_life_draw_pattern(game, pattern, x, y, w, h, rotation, flip, true);
+    _gol_builtin_draw(&gol_builtin_glider, game, x, y, rotation, flip);
 }
 
 void game_of_life_draw_lwss(
         const game_of_life_t* game, int32_t x, int32_t y, GOL_ROT rotation,
         GOL_FLIP flip) {
-    static const int w = 5;
-    static const int h = 4;
-    static const char pattern[] =
-            " XXXX"
-            "X   X"
-            "    X"
-            "X  X";
-
-    game_of_life_draw_pattern(game, pattern, x, y, w, h, rotation, flip, true);
+    _gol_builtin_draw(&gol_builtin_lwss, game, x, y, rotation, flip);
 }
 
 void game_of_life_draw_glidergun(
         const game_of_life_t* game, int32_t x, int32_t y, GOL_ROT rotation,
         GOL_FLIP flip) {
-    static const int w = 36;
-    static const int h = 9;
-    static const char pattern[] =
-            "                        X           "
-            "                      X X           "
-            "            XX      XX            XX"
-            "           X   X    XX            XX"
-            "XX        X     X   XX              "
-            "XX        X   X XX    X X           "
-            "          X     X       X           "
-            "           X   X                    "
-            "            XX                      ";
-
-    game_of_life_draw_pattern(game, pattern, x, y, w, h, rotation, flip, true);
+    _gol_builtin_draw(&gol_builtin_glidergun, game, x, y, rotation, flip);
 }
-
@@ -28,18 +28,69 @@
 #ifndef NIKLASROSENSTEIN_GAME_OF_LIFE
 #define NIKLASROSENSTEIN_GAME_OF_LIFE
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include "golrule.h"
 
-/* This structure represents a cell in a Game of Life grid. It has two
- * members representing the current state of the cell and the previous
- * state of the cell. During calculation of the next generation, the
- * member "prev_state" is used to temporarily store the new state of the
- * cell. */
-typedef struct _cell {
-    bool state;
-    bool prev_state;
-} cell_t;
+/* Identifiers of the kernels that can calculate the next generation. The
+ * vectorized kernels are only available on CPUs that support the respective
+ * instruction set. */
+typedef enum GOL_KERNEL {
+    GOL_KERNEL_AUTO = 0,
+    GOL_KERNEL_SCALAR,
+    GOL_KERNEL_SSE2,
+    GOL_KERNEL_AVX2,
+    GOL_KERNEL_AVX512,
+} GOL_KERNEL;
+
+struct _game_of_life;
+
+/* Function type of a kernel that calculates the words [begin, end) of the
+ * next generation of the row *row* into *out*. *above* and *below* are the
+ * adjacent rows of the current generation. */
+typedef void (*game_of_life_row_kernel_t)(
+        const struct _game_of_life* game, uint64_t* out, const uint64_t* above,
+        const uint64_t* row, const uint64_t* below, uint32_t begin,
+        uint32_t end);
+
+/* The number of rows of a tile. Tiles are one word of the grid wide. */
+#define GOL_TILE_ROWS 64
+
+/* Flags of a tile. */
+typedef enum GOL_TILE {
+    /* The tile changed in the last generation. */
+    GOL_TILE_CHANGED = (1 << 0),
+
+    /* The tile or one of its neighbours changed in the last generation,
+     * so it has to be calculated in the current step. */
+    GOL_TILE_ACTIVE = (1 << 1),
+
+    /* The tile changed in the current step. */
+    GOL_TILE_NEXT = (1 << 2),
+} GOL_TILE;
+
+/* Statistics of a generation. */
+typedef struct gol_stats {
+    /* The number of living cells. */
+    uint64_t population;
+
+    /* The number of cells that came alive and that died in the step that
+     * calculated the generation. */
+    uint64_t births;
+    uint64_t deaths;
+
+    /* The bounding box of the living cells, with the maximum coordinates
+     * included. All zero if there are no living cells. */
+    uint32_t min_x;
+    uint32_t min_y;
+    uint32_t max_x;
+    uint32_t max_y;
+} gol_stats_t;
+
+/* The number of generations whose hashes are remembered to detect cycles,
+ * which is the longest period that can be detected. */
+#define GOL_HISTORY 256
 
 /* This structure represents a session of the Game of Life. */
 typedef struct _game_of_life {
@@ -51,26 +102,120 @@ typedef struct _game_of_life {
      * of the game. */
     uint64_t generation;
 
-    /* A linear array of the 2D grid of cells. */
-    cell_t* cells;
+    /* The number of 64-bit words that make up a single row of the grid. */
+    uint32_t stride;
+
+    /* The number of words between the starts of two rows in memory. Each
+     * row is surrounded by a halo word on either side. */
+    uint32_t pitch;
+
+    /* The bit-packed 2D grid of cells, one bit per cell and *stride* words
+     * per row, with rows *pitch* words apart. Bit ``i`` of word ``w`` in
+     * row ``y`` is the cell at ``(w * 64 + i, y)``. Bits beyond the width
+     * of the grid are always zero. The grid is surrounded by halo words and
+     * rows, which the generation step fills with the neighbours of the
+     * outer cells, so that its kernels don't need to handle the edges. */
+    uint64_t* cells;
+
+    /* The grid of the previous generation, in the same layout. The next
+     * generation is calculated into this grid, after which the two grids
+     * swap their places. */
+    uint64_t* prev_cells;
+
+    /* A step started by :func:`game_of_life_step_partial` that has not
+     * completed yet. The rows of tiles before *step_row* are calculated.
+     * *step_hash* is the hash of the board when the step started, and
+     * *step_time* the time spent on the step so far, in nanoseconds. */
+    bool stepping;
+    uint32_t step_row;
+    uint64_t step_hash;
+    uint64_t step_time;
+
+    /* The grid is divided into tiles of one word and GOL_TILE_ROWS rows,
+     * which carry a set of GOL_TILE flags each. Tiles that did not change
+     * and whose neighbours did not change either are skipped by the
+     * generation step, as their next generation is the same. *tile_rule*
+     * is the rule of the last step; if it differs, all tiles are
+     * calculated again. */
+    uint32_t tiles_x;
+    uint32_t tiles_y;
+    uint8_t* tiles;
+    gol_rule_t tile_rule;
+
+    /* The hash of the cells of each tile, updated with every cell that
+     * changes. See :func:`game_of_life_hash`. The generation step collects
+     * the changes of a tile in *tile_next_hash* and applies them when it
+     * completes. */
+    uint64_t* tile_hash;
+    uint64_t* tile_next_hash;
+
+    /* The number of living cells of each tile, kept up to date like
+     * *tile_hash*, and the number of cells of each tile that came alive and
+     * that died in the current step, which are added to it when the step
+     * completes. */
+    uint32_t* tile_population;
+    uint32_t* tile_births;
+    uint32_t* tile_deaths;
+
+    /* The statistics of the current generation, gathered by the step that
+     * calculated it. Changes to the grid since then are not included. */
+    gol_stats_t stats;
+
+    /* The hashes of the last generations, oldest first from *history_next*
+     * on, to detect when the board repeats itself. *period* is the period
+     * of the cycle the board has entered, or zero if none was found yet.
+     * A cycle is only reported after the board repeated itself for a
+     * whole period, *candidate* is the period being confirmed. */
+    struct {
+        uint64_t generation;
+        uint64_t hash;
+    } history[GOL_HISTORY];
+    uint32_t history_count;
+    uint32_t history_next;
+    uint32_t period;
+    uint32_t candidate;
+    uint64_t candidate_since;
+
+    /* The number of threads that calculate the next generation, each of
+     * them working on its own band of rows. The worker threads are kept
+     * in *pool* as long as the game exists. Use
+     * :func:`game_of_life_set_threads` to change the number. */
+    uint32_t threads;
+    struct _gol_pool* pool;
 
     /* This field defines whether the boundaries of the field are directly
      * adjacent to their opposite edges and corners. */
     bool adjacency;
 
-    /* The minimum and maximum number of neighbouring cells that keep
-     * a cell alive. The default value is (2, 3). */
-    struct {
-        int min;
-        int max;
-    } keep_cell;
+    /* The neighbour counts that make a dead cell alive and keep a living
+     * cell alive. The default is Conway's rule, B3/S23. Use
+     * :func:`game_of_life_set_rule` to set it from a rule string. */
+    gol_rule_t rule;
 
-    /* The minimum and maximum number of neighbouring cells that make a
-     * living cell to a dead cell. The default value is (3, 3). */
-    struct {
-        int min;
-        int max;
-    } make_cell;
+    /* The rule of the last step compiled for the kernels, see
+     * :func:`gol_rule_compile`. */
+    gol_rule_compiled_t compiled_rule;
+
+    /* A Larger than Life rule, which replaces *rule* if its range is not
+     * zero, and *tile_ltl*, the one of the last step. Its neighbour counts
+     * are running sums over the columns and rows of the grid, which cost
+     * the same for any range. *ltl_sums* holds the column sums of each
+     * thread. Set it with :func:`game_of_life_set_rule`, which allocates
+     * them. */
+    gol_ltl_rule_t ltl;
+    gol_ltl_rule_t tile_ltl;
+    uint16_t* ltl_sums;
+
+    /* The kernel that is used to calculate the next generation. Use
+     * :func:`game_of_life_set_kernel` to change it. */
+    GOL_KERNEL kernel;
+    game_of_life_row_kernel_t row_kernel;
+
+    /* The copy-on-write mappings of the snapshot file that the game was
+     * loaded from, which hold *cells* and *prev_cells*, or NULL if the
+     * grids were allocated. See :func:`game_of_life_load`. */
+    void* mappings[2];
+    size_t mapping_size;
 
 } game_of_life_t;
 
@@ -80,27 +225,155 @@ typedef struct _game_of_life {
 game_of_life_t* game_of_life_create(
         uint32_t width, uint32_t height, bool adjacency);
 
+/* Create a new Game of Life like :func:`game_of_life_create`, which calculates
+ * its generations with the specified number of threads. See
+ * :func:`game_of_life_set_threads`. */
+game_of_life_t* game_of_life_create_threaded(
+        uint32_t width, uint32_t height, bool adjacency, uint32_t threads);
+
 /* Destroy a Game of Life created with :meth:`game_of_life_create`. */
 void game_of_life_destroy(game_of_life_t* game);
 
-/* Access a Cell at the specified X and Y coordinate. If the game's
- * :attr:`game_of_life_t.adjacency` attribute is true, the indecies
+/* Returns the state of the Cell at the specified X and Y coordinate. If the
+ * game's :attr:`game_of_life_t.adjacency` attribute is true, the indecies
  * may exceed or underpass the size of the grid. If otherwise they are out
- * of the grid's bounds, NULL is returned. */
-cell_t* game_of_life_cell(const game_of_life_t* game, int32_t x, int32_t y);
+ * of the grid's bounds, false is returned. */
+bool game_of_life_cell(const game_of_life_t* game, int32_t x, int32_t y);
+
+/* Returns the bit-packed words of row *y*, see :attr:`game_of_life_t.cells`.
+ * The row must exist in the grid. Bits beyond the width of the grid must be
+ * left zero when writing to the row, and :func:`game_of_life_wake` must be
+ * called afterwards. */
+uint64_t* game_of_life_row(const game_of_life_t* game, uint32_t y);
+
+/* Returns the state of the Cell at the specified X and Y coordinate in the
+ * previous generation, with the same rules for the coordinates as
+ * :func:`game_of_life_cell`. Changes made to the grid since the last step
+ * are not reflected. */
+bool game_of_life_prev_cell(const game_of_life_t* game, int32_t x, int32_t y);
+
+/* Returns the bit-packed words of row *y* of the previous generation. While
+ * a step of :func:`game_of_life_step_partial` is in progress, the rows it
+ * calculated hold the next generation instead. */
+const uint64_t* game_of_life_prev_row(const game_of_life_t* game, uint32_t y);
+
+/* Mark all tiles of the grid as changed, so that they are calculated in
+ * the next step, and hash and count them again. This is required after the
+ * grid has been written to without :func:`game_of_life_cell_set`. */
+void game_of_life_wake(const game_of_life_t* game);
 
 /* Set the state of a Cell. Nothing happens if the specified cell does not
  * exist in the grid. */
 void game_of_life_cell_set(
         const game_of_life_t* game, int32_t x, int32_t y, bool state);
 
-/* Returns the number of living Cells around the specified cell. */
+/* Set the state of *n* adjacent cells of row *y*, starting at column *x*.
+ * The cells wrap around the edges if the game's
+ * :attr:`game_of_life_t.adjacency` attribute is true and are clipped to the
+ * grid otherwise. The cells are written a word at a time. */
+void game_of_life_draw_span(
+        const game_of_life_t* game, int32_t x, int32_t y, int64_t n,
+        bool state);
+
+/* Returns the number of living Cells around the specified cell, within the
+ * range of the Larger than Life rule if the game has one. */
 int game_of_life_neighbour_count(
         const game_of_life_t* game, int32_t x, int32_t y);
 
-/* Bring the Game of Life into its next generation. */
+/* Bring the Game of Life into its next generation. A step started by
+ * :func:`game_of_life_step_partial` is completed. */
 void game_of_life_next_generation(game_of_life_t* game);
 
+/* Calculate the next generation like :func:`game_of_life_next_generation`,
+ * but return once about *rows* rows of the grid were calculated or
+ * *nanoseconds* have passed, whichever comes first, to continue from there
+ * with the next call. Work is done in whole rows of tiles; a budget of
+ * zero is no limit. Returns true if the step completed, which makes the
+ * calculated generation the current one.
+ *
+ * Until then, the grid, the generation, the statistics, the hash and the
+ * population of the game remain those of the current generation. The grid
+ * must not be written to and the game must not be woken while a step is
+ * in progress, unless it is cancelled with :func:`game_of_life_step_cancel`
+ * first. :func:`game_of_life_set_rule` cancels it itself. */
+bool game_of_life_step_partial(
+        game_of_life_t* game, uint32_t rows, uint64_t nanoseconds);
+
+/* Abandon a step started by :func:`game_of_life_step_partial`. The
+ * calculated rows of the previous generation then hold the current one.
+ * Nothing happens if no step is in progress. */
+void game_of_life_step_cancel(game_of_life_t* game);
+
+/* Bring the Game of Life *n* generations forward, with the same result as
+ * *n* calls to :func:`game_of_life_next_generation`. On busy boards,
+ * several generations are calculated for each band of rows while it is in
+ * the cache, overlapping the bands by the rows that the generations in
+ * between depend on. Cycles are only detected in the last of the
+ * generations. A step in progress is completed as the first of them. */
+void game_of_life_advance(game_of_life_t* game, uint64_t n);
+
+/* Returns the number of living cells of the grid. Like the hash, this only
+ * adds up the counts of the tiles. */
+uint64_t game_of_life_population(const game_of_life_t* game);
+
+/* Returns a hash of the living cells of the grid. Boards with the same
+ * cells have the same hash. The hash is kept up to date with every changed
+ * word of the grid, so this only combines the hashes of the tiles. */
+uint64_t game_of_life_hash(const game_of_life_t* game);
+
+/* Bring the Game of Life into the specified generation. Once the board
+ * has entered a cycle, see :attr:`game_of_life_t.period`, whole periods are
+ * skipped without calculating them, unless the board or the rule changed
+ * since the step that found the cycle. Returns false if the generation
+ * lies in the past. */
+bool game_of_life_fast_forward(game_of_life_t* game, uint64_t generation);
+
+/* Writes a snapshot of the game to the specified file, which
+ * :func:`game_of_life_load` restores. The snapshot holds the size, the
+ * generation, the adjacency, the rule, the statistics and the cells of the
+ * game in the grid layout of :attr:`game_of_life_t.cells`, along with the
+ * state of the tiles. It is written in the byte order of the machine.
+ * Returns false if the file could not be written. */
+bool game_of_life_save(const game_of_life_t* game, const char* filename);
+
+/* Loads a game from a snapshot written by :func:`game_of_life_save`. The
+ * file is mapped into memory twice, copy-on-write, and both mappings are
+ * used as the grids of the game in place, so that only the pages that are
+ * read or written are loaded, and the file itself never changes. The game
+ * continues exactly where the saved game was, except for the cycles that
+ * were detected, the threads and the kernel. Returns NULL if the file
+ * could not be mapped or is not a valid snapshot. */
+game_of_life_t* game_of_life_load(const char* filename);
+
+/* Set the rule of the game from a rule string such as "B36/S23", see
+ * :func:`gol_rule_parse`, or a Larger than Life rule such as
+ * "R5,C0,M1,S34..58,B34..45,NM", see :func:`gol_ltl_rule_parse`. Returns
+ * false and leaves the rule unchanged if the string is not a valid rule or
+ * the column sums of a Larger than Life rule could not be allocated. A
+ * valid rule cancels a step in progress, see
+ * :func:`game_of_life_step_cancel`. */
+bool game_of_life_set_rule(game_of_life_t* game, const char* rule);
+
+/* Select the kernel that calculates the next generation. If *kernel* is
+ * GOL_KERNEL_AUTO, the widest kernel supported by the CPU is chosen, which
+ * is what :func:`game_of_life_create` does. Returns false and leaves the
+ * kernel unchanged if the CPU does not support the requested kernel. */
+bool game_of_life_set_kernel(game_of_life_t* game, GOL_KERNEL kernel);
+
+/* Returns a human readable name of the specified kernel. */
+const char* game_of_life_kernel_name(GOL_KERNEL kernel);
+
+/* Set the number of threads that calculate the next generation. A value
+ * of zero uses one thread per online CPU, a value of one (the default)
+ * calculates the generation on the calling thread only. The result is the
+ * same for any number of threads. The pages of the grids that were not
+ * written yet are written first by the thread that calculates them, which
+ * places them in the memory of its NUMA node; a board that is created
+ * with :func:`game_of_life_create_threaded` is placed that way as a whole.
+ * Returns false and leaves the game unchanged if the threads could not be
+ * started. */
+bool game_of_life_set_threads(game_of_life_t* game, uint32_t threads);
+
 /* Flags that specify whether something is mirrored or not. */
 typedef enum GOL_FLIP {
     GOL_FLIP_0 = 0,
@@ -116,8 +389,28 @@ typedef enum GOL_ROT {
     GOL_ROT_270 = 3,
 } GOL_ROT;
 
+/* A pattern in one orientation, bit-packed like the rows of the grid, with
+ * rows of *stride* words. */
+typedef struct gol_bitmap {
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    uint64_t* bits;
+} gol_bitmap_t;
+
+/* A pattern compiled for :func:`game_of_life_draw_compiled`, with a bitmap
+ * for every rotation and flip, indexed by GOL_ROT and GOL_FLIP. */
+typedef struct game_of_life_pattern {
+    /* The size of the pattern in its original orientation. */
+    int32_t width;
+    int32_t height;
+
+    gol_bitmap_t bitmaps[4][4];
+    uint64_t* bits;
+} game_of_life_pattern_t;
+
 /* Draws a block with the specified dimension and state into the
- * game's grid. */
+ * game's grid, a row span at a time. */
 void game_of_life_draw_block(
         const game_of_life_t* game, int32_t x, int32_t y, int32_t w, int32_t h,
         bool state);
@@ -131,6 +424,23 @@ void game_of_life_draw_pattern(
         const game_of_life_t* game, const char* pattern, int32_t x, int32_t y,
         int32_t w, int32_t h, GOL_ROT rotation, GOL_FLIP flip, bool reset);
 
+/* Compiles a pattern in the format of :func:`game_of_life_draw_pattern`
+ * into a bitmap for every rotation and flip. Patterns that are drawn many
+ * times are compiled once and drawn with :func:`game_of_life_draw_compiled`.
+ * Returns NULL if memory allocation failed or the size is invalid. */
+game_of_life_pattern_t* game_of_life_pattern_compile(
+        const char* pattern, int32_t w, int32_t h);
+
+/* Destroy a pattern compiled with :func:`game_of_life_pattern_compile`. */
+void game_of_life_pattern_destroy(game_of_life_pattern_t* pattern);
+
+/* Draws a compiled pattern like :func:`game_of_life_draw_pattern`. Its rows
+ * are written a word at a time, split where they wrap around the edges of
+ * the grid. */
+void game_of_life_draw_compiled(
+        const game_of_life_t* game, const game_of_life_pattern_t* pattern,
+        int32_t x, int32_t y, GOL_ROT rotation, GOL_FLIP flip, bool reset);
+
 /* Draws Glider at the specified position (top-left corner) into the game's
  * grid. A Glider has a dimension of 3 columns and 3 rows. The default
  * orientation is to the bottom left. Use the *flip_h* and *flip_v* parameters
@@ -165,7 +475,8 @@ void game_of_life_draw_lwss(
 /* Draws a Glider Gun at the specified position (top-left corner). By default,
  * the Glider Gun shoots to the bottom right. You can rotate and flip the
  * pattern with the respective parameters. The Glider Gun requires 36 columns
- * and 9 rows of space. */
+ * and 9 rows of space. Like the Glider and the LWSS, it is compiled with
+ * :func:`game_of_life_pattern_compile` when it is first drawn. */
 void game_of_life_draw_glidergun(
         const game_of_life_t* game, int32_t x, int32_t y, GOL_ROT rotation,
         GOL_FLIP flip);
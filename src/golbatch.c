@@ -0,0 +1,294 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: golbatch.c
+ * description: Batches of small boards of the Game of Life
+ * author: Donkey Coding Group */
+
+#include <stdlib.h>
+#include <string.h>
+#include "golbatch.h"
+#include "golkernel.h"
+
+
+/* Maps the X and Y coordinate into a board, like the games do. Returns
+ * false if the coordinate lies outside of a board without adjacency. */
+static bool _gol_batch_locate(
+        const gol_batch_t* batch, int32_t* x, int32_t* y) {
+    if (batch->adjacency) {
+        *x %= (int32_t) batch->width;
+        *y %= (int32_t) batch->height;
+        if (*x < 0) *x += batch->width;
+        if (*y < 0) *y += batch->height;
+    }
+    else if (*x < 0 || *y < 0 || *x >= batch->width || *y >= batch->height) {
+        return false;
+    }
+    return true;
+}
+
+/* Returns the word of the cell (x, y) of a group in *cells*. */
+static inline uint64_t* _gol_batch_word(
+        const gol_batch_t* batch, uint64_t* cells, uint32_t group, uint32_t x,
+        uint32_t y) {
+    return cells + group * batch->group_size + (size_t) (y + 1) * batch->pitch +
+           x + 1;
+}
+
+/* Copies the opposite edges of a group into its halo. */
+static void _gol_batch_fill_halo(const gol_batch_t* batch, uint64_t* group) {
+    uint32_t pitch = batch->pitch;
+    uint32_t width = batch->width;
+    uint32_t height = batch->height;
+    uint32_t y;
+    for (y=1; y <= height; y++) {
+        uint64_t* row = group + (size_t) y * pitch;
+        row[0] = row[width];
+        row[width + 1] = row[1];
+    }
+    memcpy(group, group + (size_t) height * pitch, sizeof(uint64_t) * pitch);
+    memcpy(group + (size_t) (height + 1) * pitch, group + pitch,
+           sizeof(uint64_t) * pitch);
+}
+
+/* Calculates the next generation of a row of a group. Every word holds its
+ * own cell of 64 boards, so the neighbours are simply the adjacent words,
+ * which are added up GOL_BATCH_LANES words at a time. */
+#define GOL_BATCH_LANES 4
+
+__attribute__((always_inline))
+static inline void _gol_batch_row(
+        const gol_batch_t* batch, uint64_t* out, const uint64_t* above,
+        const uint64_t* row, const uint64_t* below) {
+    typedef uint64_t vec_t __attribute__((vector_size(GOL_BATCH_LANES * 8)));
+    const uint64_t* base = batch->compiled_rule.base;
+    const uint64_t* flip = batch->compiled_rule.flip;
+    uint32_t width = batch->width;
+    uint32_t x;
+
+    for (x=0; x + GOL_BATCH_LANES <= width; x += GOL_BATCH_LANES) {
+        vec_t aw, a, ae, rw, r, re, bw, b, be;
+        memcpy(&aw, above + x - 1, sizeof(vec_t));
+        memcpy(&a, above + x, sizeof(vec_t));
+        memcpy(&ae, above + x + 1, sizeof(vec_t));
+        memcpy(&rw, row + x - 1, sizeof(vec_t));
+        memcpy(&r, row + x, sizeof(vec_t));
+        memcpy(&re, row + x + 1, sizeof(vec_t));
+        memcpy(&bw, below + x - 1, sizeof(vec_t));
+        memcpy(&b, below + x, sizeof(vec_t));
+        memcpy(&be, below + x + 1, sizeof(vec_t));
+
+        /* Add up the eight neighbours with full adders, the same way
+         * gol_kernel_next_word() does. */
+        vec_t t, s0, c0, s1, c1, s2, c2, c3, d0, d1;
+        t = aw ^ a; s0 = t ^ ae; c0 = (aw & a) | (t & ae);
+        t = bw ^ b; s1 = t ^ be; c1 = (bw & b) | (t & be);
+        s2 = rw ^ re; c2 = rw & re;
+
+        vec_t n1, n2, n4, n8;
+        t = s0 ^ s1; n1 = t ^ s2; c3 = (s0 & s1) | (t & s2);
+        t = c0 ^ c1; d0 = (c0 & c1) | (t & c2); t = t ^ c2;
+        n2 = t ^ c3; d1 = t & c3;
+        n4 = d0 ^ d1;
+        n8 = d0 & d1;
+
+        vec_t next = GOL_KERNEL_APPLY_RULE(r, n1, n2, n4, n8, base, flip);
+        memcpy(out + x, &next, sizeof(vec_t));
+    }
+
+    for (; x < width; x++) {
+        out[x] = gol_kernel_next_word(
+                above[x - 1], above[x], above[x + 1], row[x - 1], row[x],
+                row[x + 1], below[x - 1], below[x], below[x + 1],
+                &batch->compiled_rule);
+    }
+}
+
+/* The portable kernel. */
+static void _gol_batch_row_generic(
+        const gol_batch_t* batch, uint64_t* out, const uint64_t* above,
+        const uint64_t* row, const uint64_t* below) {
+    _gol_batch_row(batch, out, above, row, below);
+}
+
+#ifdef GOL_KERNEL_X86
+/* The same kernel compiled for AVX2, with a vector of words per
+ * instruction. */
+__attribute__((target("avx2")))
+static void _gol_batch_row_avx2(
+        const gol_batch_t* batch, uint64_t* out, const uint64_t* above,
+        const uint64_t* row, const uint64_t* below) {
+    _gol_batch_row(batch, out, above, row, below);
+}
+#endif /* GOL_KERNEL_X86 */
+
+
+gol_batch_t* gol_batch_create(
+        uint32_t width, uint32_t height, uint32_t count, bool adjacency) {
+    if (width < 1 || height < 1 || count < 1) return NULL;
+
+    gol_batch_t* batch = malloc(sizeof(gol_batch_t));
+    if (batch == NULL) return NULL;
+
+    batch->width = width;
+    batch->height = height;
+    batch->count = count;
+    batch->groups = (count + GOL_BATCH_GROUP - 1) / GOL_BATCH_GROUP;
+    batch->generation = 0;
+    batch->adjacency = adjacency;
+    batch->rule = gol_rule_conway();
+    gol_rule_compile(batch->rule, &batch->compiled_rule);
+    batch->pitch = width + 2;
+    batch->group_size = (size_t) batch->pitch * (height + 2);
+
+    size_t words = batch->group_size * batch->groups;
+    batch->cells = calloc(words, sizeof(uint64_t));
+    batch->next_cells = calloc(words, sizeof(uint64_t));
+    if (batch->cells == NULL || batch->next_cells == NULL) {
+        free(batch->cells);
+        free(batch->next_cells);
+        free(batch);
+        return NULL;
+    }
+
+    batch->row_kernel = _gol_batch_row_generic;
+#ifdef GOL_KERNEL_X86
+    if (gol_kernel_lookup(GOL_KERNEL_AVX2)) {
+        batch->row_kernel = _gol_batch_row_avx2;
+    }
+#endif
+    return batch;
+}
+
+void gol_batch_destroy(gol_batch_t* batch) {
+    if (batch) {
+        free(batch->cells);
+        free(batch->next_cells);
+        free(batch);
+    }
+}
+
+bool gol_batch_set_rule(gol_batch_t* batch, const char* rule) {
+    return gol_rule_parse(rule, &batch->rule);
+}
+
+bool gol_batch_cell(
+        const gol_batch_t* batch, uint32_t board, int32_t x, int32_t y) {
+    if (board >= batch->count) return false;
+    if (!_gol_batch_locate(batch, &x, &y)) return false;
+    uint64_t word = *_gol_batch_word(
+            batch, batch->cells, board / GOL_BATCH_GROUP, x, y);
+    return (word >> (board % GOL_BATCH_GROUP)) & 1;
+}
+
+void gol_batch_cell_set(
+        gol_batch_t* batch, uint32_t board, int32_t x, int32_t y, bool state) {
+    if (board >= batch->count) return;
+    if (!_gol_batch_locate(batch, &x, &y)) return;
+    uint64_t* word = _gol_batch_word(
+            batch, batch->cells, board / GOL_BATCH_GROUP, x, y);
+    uint64_t bit = (uint64_t) 1 << (board % GOL_BATCH_GROUP);
+    if (state) *word |= bit;
+    else *word &= ~bit;
+}
+
+uint32_t gol_batch_population(const gol_batch_t* batch, uint32_t board) {
+    uint32_t count = 0;
+    uint32_t x, y;
+    if (board >= batch->count) return 0;
+    for (y=0; y < batch->height; y++) {
+        const uint64_t* row = _gol_batch_word(
+                batch, batch->cells, board / GOL_BATCH_GROUP, 0, y);
+        for (x=0; x < batch->width; x++) {
+            count += (row[x] >> (board % GOL_BATCH_GROUP)) & 1;
+        }
+    }
+    return count;
+}
+
+void gol_batch_next_generation(gol_batch_t* batch) {
+    uint32_t pitch = batch->pitch;
+    uint32_t g, y;
+
+    /* The rule may have been changed directly. */
+    gol_rule_compile(batch->rule, &batch->compiled_rule);
+
+    for (g=0; g < batch->groups; g++) {
+        uint64_t* group = batch->cells + g * batch->group_size;
+        uint64_t* next = batch->next_cells + g * batch->group_size;
+
+        /* The halo of a group without adjacency stays zero. */
+        if (batch->adjacency) _gol_batch_fill_halo(batch, group);
+
+        for (y=0; y < batch->height; y++) {
+            const uint64_t* row = group + (size_t) (y + 1) * pitch + 1;
+            batch->row_kernel(batch, next + (size_t) (y + 1) * pitch + 1,
+                              row - pitch, row, row + pitch);
+        }
+    }
+
+    uint64_t* cells = batch->cells;
+    batch->cells = batch->next_cells;
+    batch->next_cells = cells;
+    batch->generation++;
+}
+
+bool gol_batch_import(
+        gol_batch_t* batch, uint32_t board, const game_of_life_t* game) {
+    if (board >= batch->count) return false;
+    if (game->width != batch->width || game->height != batch->height) {
+        return false;
+    }
+
+    uint64_t bit = (uint64_t) 1 << (board % GOL_BATCH_GROUP);
+    uint32_t x, y;
+    for (y=0; y < batch->height; y++) {
+        const uint64_t* src = game_of_life_row(game, y);
+        uint64_t* dst = _gol_batch_word(
+                batch, batch->cells, board / GOL_BATCH_GROUP, 0, y);
+        for (x=0; x < batch->width; x++) {
+            if ((src[x / 64] >> (x % 64)) & 1) dst[x] |= bit;
+            else dst[x] &= ~bit;
+        }
+    }
+    return true;
+}
+
+bool gol_batch_export(
+        const gol_batch_t* batch, uint32_t board, game_of_life_t* game) {
+    if (board >= batch->count) return false;
+    if (game->width != batch->width || game->height != batch->height) {
+        return false;
+    }
+
+    uint32_t shift = board % GOL_BATCH_GROUP;
+    uint32_t x, y;
+    for (y=0; y < batch->height; y++) {
+        const uint64_t* src = _gol_batch_word(
+                batch, batch->cells, board / GOL_BATCH_GROUP, 0, y);
+        uint64_t* dst = game_of_life_row(game, y);
+        memset(dst, 0, sizeof(uint64_t) * game->stride);
+        for (x=0; x < batch->width; x++) {
+            dst[x / 64] |= ((src[x] >> shift) & 1) << (x % 64);
+        }
+    }
+    game_of_life_wake(game);
+    return true;
+}
@@ -0,0 +1,128 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: golbatch.h
+ * description: Batches of small boards of the Game of Life
+ * author: Donkey Coding Group
+ *
+ * This C header defines a batch of many boards of the same size that are
+ * stored and calculated together. The boards are interleaved: a word holds
+ * the same cell of 64 boards, so a generation is calculated for all of
+ * them at once without any shifting of bits. */
+
+#ifndef NIKLASROSENSTEIN_GAME_OF_LIFE_BATCH
+#define NIKLASROSENSTEIN_GAME_OF_LIFE_BATCH
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "gol.h"
+
+/* The number of boards that share a word. */
+#define GOL_BATCH_GROUP 64
+
+struct _gol_batch;
+
+/* Function type of a kernel that calculates the next generation of a row
+ * of a group of boards, see :func:`gol_batch_next_generation`. */
+typedef void (*gol_batch_row_kernel_t)(
+        const struct _gol_batch* batch, uint64_t* out, const uint64_t* above,
+        const uint64_t* row, const uint64_t* below);
+
+/* This structure represents a batch of boards of the same size, which all
+ * use the same rule and adjacency. */
+typedef struct _gol_batch {
+    /* The width and height of each board. */
+    uint32_t width;
+    uint32_t height;
+
+    /* The number of boards, and the number of groups of GOL_BATCH_GROUP
+     * boards that they are stored in. */
+    uint32_t count;
+    uint32_t groups;
+
+    /* The number of generations that have been passed since the creation
+     * of the batch. */
+    uint64_t generation;
+
+    /* Whether the edges of the boards are adjacent to their opposite
+     * edges, see :class:`game_of_life_t`. */
+    bool adjacency;
+
+    /* The rule of all boards, and its compiled form. */
+    gol_rule_t rule;
+    gol_rule_compiled_t compiled_rule;
+
+    /* The cells of each group, one word per cell, in rows of *pitch*
+     * words. Bit ``b`` of the word of a cell in group ``g`` is the cell of
+     * board ``g * GOL_BATCH_GROUP + b``. Each group is surrounded by a halo
+     * of one cell and takes *group_size* words. *next_cells* receives the
+     * next generation. */
+    uint32_t pitch;
+    size_t group_size;
+    uint64_t* cells;
+    uint64_t* next_cells;
+
+    /* The kernel that calculates the rows. */
+    gol_batch_row_kernel_t row_kernel;
+} gol_batch_t;
+
+/* Create a batch of *count* empty boards of the specified size with
+ * Conway's rule. Returns NULL if memory allocation failed or a parameter
+ * is zero. */
+gol_batch_t* gol_batch_create(
+        uint32_t width, uint32_t height, uint32_t count, bool adjacency);
+
+/* Destroy a batch created with :func:`gol_batch_create`. */
+void gol_batch_destroy(gol_batch_t* batch);
+
+/* Set the rule of all boards from a rule string, see
+ * :func:`gol_rule_parse`. Returns false and leaves the rule unchanged if
+ * the string is not a valid rule. */
+bool gol_batch_set_rule(gol_batch_t* batch, const char* rule);
+
+/* Returns the state of a cell of a board. Coordinates are handled like by
+ * :func:`game_of_life_cell`; false is returned for boards that don't
+ * exist. */
+bool gol_batch_cell(
+        const gol_batch_t* batch, uint32_t board, int32_t x, int32_t y);
+
+/* Set the state of a cell of a board. Nothing happens if the cell or the
+ * board does not exist. */
+void gol_batch_cell_set(
+        gol_batch_t* batch, uint32_t board, int32_t x, int32_t y, bool state);
+
+/* Returns the number of living cells of a board. */
+uint32_t gol_batch_population(const gol_batch_t* batch, uint32_t board);
+
+/* Bring all boards into their next generation. */
+void gol_batch_next_generation(gol_batch_t* batch);
+
+/* Copy the cells of a game into a board of the batch. Returns false if the
+ * board does not exist or the game has a different size. */
+bool gol_batch_import(
+        gol_batch_t* batch, uint32_t board, const game_of_life_t* game);
+
+/* Copy the cells of a board of the batch into a game. Returns false if the
+ * board does not exist or the game has a different size. */
+bool gol_batch_export(
+        const gol_batch_t* batch, uint32_t board, game_of_life_t* game);
+
+#endif /* NIKLASROSENSTEIN_GAME_OF_LIFE_BATCH */
@@ -0,0 +1,470 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: goldomain.c
+ * description: Game of Life boards split across worker processes
+ * author: Donkey Coding Group */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "goldomain.h"
+#include "golkernel.h"
+
+/* The size of a cache line. The progress of each worker has its own, so
+ * that the workers don't contend for them. */
+#define GOL_DOMAIN_LINE 64
+
+/* Each strip starts on a page of its own, so that the first touch of the
+ * worker decides where all of its pages are placed. */
+#define GOL_DOMAIN_PAGE 4096
+
+/* How often a worker checks the progress of a neighbour before it yields
+ * the CPU, and how long the coordinator waits before it checks whether
+ * the workers are still alive. */
+#define GOL_DOMAIN_SPINS 64
+#define GOL_DOMAIN_POLL_NS (100 * 1000 * 1000)
+
+/* The commands of the coordinator. */
+typedef enum GOL_DOMAIN_COMMAND {
+    /* Write the strips of the worker for the first time. */
+    GOL_DOMAIN_TOUCH = 0,
+
+    /* Calculate *count* generations from *generation* on. */
+    GOL_DOMAIN_ADVANCE,
+
+    /* Exit the worker process. */
+    GOL_DOMAIN_STOP,
+} GOL_DOMAIN_COMMAND;
+
+/* The progress of a worker in the current command, on a cache line of its
+ * own. A value of ``s + 1`` means that the generation ``s`` generations
+ * after the start of the command is complete in the strip of the worker,
+ * including the halo words of its rows. */
+typedef struct _gol_domain_progress {
+    uint64_t value;
+    char padding[GOL_DOMAIN_LINE - sizeof(uint64_t)];
+} gol_domain_progress_t;
+
+/* The control block at the start of the shared memory. Like in a
+ * :class:`gol_pool_t`, a command is published by changing the *ticket*,
+ * and the last worker to finish it signals *done*. */
+struct _gol_domain_shared {
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    uint64_t ticket;
+    GOL_DOMAIN_COMMAND command;
+    uint64_t generation;
+    uint64_t count;
+    gol_rule_t rule;
+    uint32_t pending;
+};
+
+
+/* Returns *size* rounded up to a multiple of *align*. */
+static size_t _gol_domain_align(size_t size, size_t align) {
+    return (size + align - 1) / align * align;
+}
+
+/* Returns the progress of worker *index*. */
+static gol_domain_progress_t* _gol_domain_progress(
+        const gol_domain_t* domain, uint32_t index) {
+    char* base = (char*) domain->shared;
+    size_t offset = _gol_domain_align(
+            sizeof(struct _gol_domain_shared), GOL_DOMAIN_LINE);
+    return (gol_domain_progress_t*) (base + offset) + index;
+}
+
+/* Returns the grid of worker *index* for generation *generation*. */
+static uint64_t* _gol_domain_strip(
+        const gol_domain_t* domain, uint32_t index, uint64_t generation) {
+    return domain->strips[2 * index + (generation & 1)];
+}
+
+/* Returns the number of rows of the strip of worker *index*. */
+static uint32_t _gol_domain_rows(const gol_domain_t* domain, uint32_t index) {
+    return domain->first_row[index + 1] - domain->first_row[index];
+}
+
+/* Waits until a neighbour has completed the step *value* - 1. */
+static void _gol_domain_wait(gol_domain_progress_t* progress, uint64_t value) {
+    uint32_t spins = 0;
+    while (__atomic_load_n(&progress->value, __ATOMIC_ACQUIRE) < value) {
+        if (++spins >= GOL_DOMAIN_SPINS) {
+            sched_yield();
+            spins = 0;
+        }
+    }
+}
+
+/* Copies the halo row of a strip from the edge row *row* of the neighbour
+ * in the grid *from*, or clears it if there is no neighbour. */
+static void _gol_domain_halo_row(
+        const gol_domain_t* domain, uint64_t* halo, const uint64_t* from,
+        uint32_t row) {
+    uint32_t pitch = domain->context->pitch;
+    if (from == NULL) {
+        memset(halo - 1, 0, sizeof(uint64_t) * pitch);
+        return;
+    }
+    memcpy(halo - 1, from + (size_t) row * pitch - 1, sizeof(uint64_t) * pitch);
+}
+
+/* Calculates *count* generations of the strip of worker *index*. Before
+ * each generation, the worker waits for its neighbours to complete the
+ * previous one and copies their edge rows, which they leave alone until
+ * this worker has completed the generation as well. */
+static void _gol_domain_run(
+        const gol_domain_t* domain, uint32_t index, uint64_t generation,
+        uint64_t count) {
+    const game_of_life_t* context = domain->context;
+    uint32_t pitch = context->pitch;
+    uint32_t rows = _gol_domain_rows(domain, index);
+    uint32_t workers = domain->workers;
+    gol_domain_progress_t* progress = _gol_domain_progress(domain, index);
+    uint64_t s;
+    uint32_t y;
+
+    /* The neighbours of the outer strips are the opposite strips if
+     * adjacency is enabled. */
+    int64_t above = index > 0 ? (int64_t) index - 1
+                  : context->adjacency ? (int64_t) workers - 1 : -1;
+    int64_t below = index + 1 < workers ? (int64_t) index + 1
+                  : context->adjacency ? 0 : -1;
+
+    uint64_t* cells = _gol_domain_strip(domain, index, generation);
+    for (y=0; y < rows; y++) {
+        gol_kernel_fill_row_halo(context, cells + (size_t) y * pitch);
+    }
+    __atomic_store_n(&progress->value, 1, __ATOMIC_RELEASE);
+
+    for (s=1; s <= count; s++) {
+        uint64_t* row = _gol_domain_strip(domain, index, generation + s - 1);
+        uint64_t* out = _gol_domain_strip(domain, index, generation + s);
+        const uint64_t* from;
+
+        from = NULL;
+        if (above >= 0) {
+            _gol_domain_wait(_gol_domain_progress(domain, above), s);
+            from = _gol_domain_strip(domain, above, generation + s - 1);
+        }
+        _gol_domain_halo_row(domain, row - pitch, from,
+                             above >= 0 ? _gol_domain_rows(domain, above) - 1 : 0);
+
+        from = NULL;
+        if (below >= 0) {
+            _gol_domain_wait(_gol_domain_progress(domain, below), s);
+            from = _gol_domain_strip(domain, below, generation + s - 1);
+        }
+        _gol_domain_halo_row(domain, row + (size_t) rows * pitch, from, 0);
+
+        for (y=0; y < rows; y++, row += pitch, out += pitch) {
+            context->row_kernel(context, out, row - pitch, row, row + pitch,
+                                0, context->stride);
+        }
+        out = _gol_domain_strip(domain, index, generation + s);
+        for (y=0; y < rows; y++) {
+            gol_kernel_fill_row_halo(context, out + (size_t) y * pitch);
+        }
+        __atomic_store_n(&progress->value, s + 1, __ATOMIC_RELEASE);
+    }
+}
+
+/* The main loop of worker *index*, which never returns. */
+static void _gol_domain_worker(gol_domain_t* domain, uint32_t index) {
+    struct _gol_domain_shared* shared = domain->shared;
+    game_of_life_t* context = domain->context;
+    uint64_t ticket = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&shared->lock);
+        while (shared->ticket == ticket) {
+            pthread_cond_wait(&shared->start, &shared->lock);
+        }
+        ticket = shared->ticket;
+        GOL_DOMAIN_COMMAND command = shared->command;
+        uint64_t generation = shared->generation;
+        uint64_t count = shared->count;
+        context->rule = shared->rule;
+        pthread_mutex_unlock(&shared->lock);
+
+        if (command == GOL_DOMAIN_STOP) break;
+        if (command == GOL_DOMAIN_TOUCH) {
+            size_t size = sizeof(uint64_t) * context->pitch *
+                          (_gol_domain_rows(domain, index) + 2);
+            memset(domain->strips[2 * index] - context->pitch - 1, 0, size);
+            memset(domain->strips[2 * index + 1] - context->pitch - 1, 0, size);
+        }
+        else {
+            gol_rule_compile(context->rule, &context->compiled_rule);
+            _gol_domain_run(domain, index, generation, count);
+        }
+
+        pthread_mutex_lock(&shared->lock);
+        if (--shared->pending == 0) {
+            pthread_cond_signal(&shared->done);
+        }
+        pthread_mutex_unlock(&shared->lock);
+    }
+    _exit(0);
+}
+
+/* Returns true if one of the worker processes has exited. */
+static bool _gol_domain_dead(gol_domain_t* domain) {
+    uint32_t i;
+    for (i=0; i < domain->workers; i++) {
+        if (domain->pids[i] > 0 &&
+                waitpid(domain->pids[i], NULL, WNOHANG) != 0) {
+            domain->pids[i] = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Publishes a command and waits until every worker finished it, unless it
+ * is GOL_DOMAIN_STOP. Returns false if a worker died. */
+static bool _gol_domain_command(
+        gol_domain_t* domain, GOL_DOMAIN_COMMAND command, uint64_t count) {
+    struct _gol_domain_shared* shared = domain->shared;
+    uint32_t i;
+    if (domain->failed) return false;
+
+    pthread_mutex_lock(&shared->lock);
+    for (i=0; i < domain->workers; i++) {
+        _gol_domain_progress(domain, i)->value = 0;
+    }
+    shared->command = command;
+    shared->generation = domain->generation;
+    shared->count = count;
+    shared->rule = domain->context->rule;
+    shared->pending = domain->workers;
+    shared->ticket++;
+    pthread_cond_broadcast(&shared->start);
+
+    while (command != GOL_DOMAIN_STOP && shared->pending > 0) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += GOL_DOMAIN_POLL_NS;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        int error = pthread_cond_timedwait(&shared->done, &shared->lock, &deadline);
+        if (error == ETIMEDOUT && _gol_domain_dead(domain)) {
+            domain->failed = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&shared->lock);
+    return !domain->failed;
+}
+
+gol_domain_t* gol_domain_create(
+        uint32_t width, uint32_t height, bool adjacency, uint32_t workers) {
+    uint32_t i;
+    if (width < 1 || height < 1) return NULL;
+    if (workers == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = (cpus > 0) ? (uint32_t) cpus : 1;
+    }
+    if (workers > height) workers = height;
+
+    gol_domain_t* domain = calloc(1, sizeof(gol_domain_t));
+    if (domain == NULL) return NULL;
+    domain->width = width;
+    domain->height = height;
+    domain->workers = 0;
+    domain->pids = calloc(workers, sizeof(pid_t));
+    domain->first_row = malloc(sizeof(uint32_t) * (workers + 1));
+    domain->strips = malloc(sizeof(uint64_t*) * 2 * workers);
+    domain->context = game_of_life_create(width, 1, adjacency);
+    if (domain->pids == NULL || domain->first_row == NULL ||
+            domain->strips == NULL || domain->context == NULL) {
+        gol_domain_destroy(domain);
+        return NULL;
+    }
+
+    /* The control block and the progress of the workers come first, then
+     * the grids of each strip. */
+    uint32_t pitch = domain->context->pitch;
+    size_t size = _gol_domain_align(
+            sizeof(struct _gol_domain_shared), GOL_DOMAIN_LINE);
+    size += sizeof(gol_domain_progress_t) * workers;
+    size_t* offsets = malloc(sizeof(size_t) * 2 * workers);
+    if (offsets == NULL) {
+        gol_domain_destroy(domain);
+        return NULL;
+    }
+    for (i=0; i <= workers; i++) {
+        domain->first_row[i] = (uint64_t) height * i / workers;
+    }
+    for (i=0; i < 2 * workers; i++) {
+        size = _gol_domain_align(size, GOL_DOMAIN_PAGE);
+        offsets[i] = size;
+        size += sizeof(uint64_t) * pitch *
+                ((size_t) _gol_domain_rows(domain, i / 2) + 2);
+    }
+
+    void* shared = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        free(offsets);
+        gol_domain_destroy(domain);
+        return NULL;
+    }
+    domain->shared = shared;
+    domain->shared_size = size;
+    for (i=0; i < 2 * workers; i++) {
+        domain->strips[i] = (uint64_t*) ((char*) shared + offsets[i]) + pitch + 1;
+    }
+    free(offsets);
+
+    pthread_mutexattr_t mutex_attr;
+    pthread_condattr_t cond_attr;
+    pthread_mutexattr_init(&mutex_attr);
+    pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init(&domain->shared->lock, &mutex_attr);
+    pthread_cond_init(&domain->shared->start, &cond_attr);
+    pthread_cond_init(&domain->shared->done, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    pthread_mutexattr_destroy(&mutex_attr);
+
+    for (i=0; i < workers; i++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            domain->workers = workers;
+            _gol_domain_worker(domain, i);
+        }
+        if (pid < 0) {
+            gol_domain_destroy(domain);
+            return NULL;
+        }
+        domain->pids[i] = pid;
+        domain->workers = i + 1;
+    }
+
+    if (!_gol_domain_command(domain, GOL_DOMAIN_TOUCH, 0)) {
+        gol_domain_destroy(domain);
+        return NULL;
+    }
+    return domain;
+}
+
+void gol_domain_destroy(gol_domain_t* domain) {
+    uint32_t i;
+    if (domain == NULL) return;
+
+    if (domain->shared) {
+        /* Workers that are still running exit at the stop command; those
+         * of a failed domain may wait for a dead neighbour forever. */
+        if (domain->failed) {
+            for (i=0; i < domain->workers; i++) {
+                if (domain->pids[i] > 0) kill(domain->pids[i], SIGKILL);
+            }
+        }
+        else {
+            _gol_domain_command(domain, GOL_DOMAIN_STOP, 0);
+        }
+        for (i=0; i < domain->workers; i++) {
+            if (domain->pids[i] > 0) waitpid(domain->pids[i], NULL, 0);
+        }
+        pthread_cond_destroy(&domain->shared->done);
+        pthread_cond_destroy(&domain->shared->start);
+        pthread_mutex_destroy(&domain->shared->lock);
+        munmap(domain->shared, domain->shared_size);
+    }
+
+    game_of_life_destroy(domain->context);
+    free(domain->strips);
+    free(domain->first_row);
+    free(domain->pids);
+    free(domain);
+}
+
+bool gol_domain_set_rule(gol_domain_t* domain, const char* rule) {
+    return gol_rule_parse(rule, &domain->context->rule);
+}
+
+bool gol_domain_import(gol_domain_t* domain, const game_of_life_t* game) {
+    uint32_t stride = domain->context->stride;
+    uint32_t pitch = domain->context->pitch;
+    uint32_t i, y;
+    if (domain->failed || game->ltl.range) return false;
+    if (game->width != domain->width || game->height != domain->height) {
+        return false;
+    }
+
+    /* The halo words are filled by the workers when they start. */
+    for (i=0; i < domain->workers; i++) {
+        uint64_t* cells = _gol_domain_strip(domain, i, game->generation);
+        for (y=0; y < _gol_domain_rows(domain, i); y++) {
+            memcpy(cells + (size_t) y * pitch,
+                   game_of_life_row(game, domain->first_row[i] + y),
+                   sizeof(uint64_t) * stride);
+        }
+    }
+    domain->generation = game->generation;
+    domain->context->rule = game->rule;
+    return true;
+}
+
+bool gol_domain_export(const gol_domain_t* domain, game_of_life_t* game) {
+    uint32_t stride = domain->context->stride;
+    uint32_t pitch = domain->context->pitch;
+    uint64_t tail_mask = gol_kernel_tail_mask(domain->width);
+    uint32_t i, y;
+    if (domain->failed) return false;
+    if (game->width != domain->width || game->height != domain->height) {
+        return false;
+    }
+
+    /* The rows of the strips may carry a cell of their eastern halo, see
+     * :func:`gol_kernel_fill_row_halo`. */
+    for (i=0; i < domain->workers; i++) {
+        const uint64_t* cells = _gol_domain_strip(domain, i, domain->generation);
+        for (y=0; y < _gol_domain_rows(domain, i); y++) {
+            uint64_t* row = game_of_life_row(game, domain->first_row[i] + y);
+            memcpy(row, cells + (size_t) y * pitch, sizeof(uint64_t) * stride);
+            row[stride - 1] &= tail_mask;
+        }
+    }
+    game->generation = domain->generation;
+    game->rule = domain->context->rule;
+    game_of_life_wake(game);
+    return true;
+}
+
+bool gol_domain_advance(gol_domain_t* domain, uint64_t n) {
+    if (n == 0) return !domain->failed;
+    if (!_gol_domain_command(domain, GOL_DOMAIN_ADVANCE, n)) return false;
+    domain->generation += n;
+    return true;
+}
@@ -0,0 +1,111 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: goldomain.h
+ * description: Game of Life boards split across worker processes
+ * author: Donkey Coding Group
+ *
+ * This C header defines a board that is split into strips of rows, each of
+ * which is owned and calculated by its own worker process. The strips live
+ * in memory shared with the calling process, and every worker touches its
+ * strip first, so that its pages are placed on the worker's NUMA node. In
+ * every generation, a worker copies the edge rows of the neighbouring
+ * strips into its halo rows and waits for no one else, so the processes
+ * only synchronise with their neighbours. The calling process coordinates
+ * the workers and assembles the board on request. */
+
+#ifndef NIKLASROSENSTEIN_GAME_OF_LIFE_DOMAIN
+#define NIKLASROSENSTEIN_GAME_OF_LIFE_DOMAIN
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "gol.h"
+
+struct _gol_domain_shared;
+
+/* This structure represents a board split across worker processes. */
+typedef struct _gol_domain {
+    /* The width and height of the board. */
+    uint32_t width;
+    uint32_t height;
+
+    /* The number of generations that have been passed since the creation
+     * of the domain. */
+    uint64_t generation;
+
+    /* The number of worker processes and their process ids. Worker ``i``
+     * owns the rows [``first_row[i]``, ``first_row[i + 1]``). */
+    uint32_t workers;
+    pid_t* pids;
+    uint32_t* first_row;
+
+    /* A game of a single row that carries the rule, the adjacency and the
+     * kernel for the workers, which inherit it. */
+    game_of_life_t* context;
+
+    /* The memory shared with the workers, of *shared_size* bytes, which
+     * holds the control block and the strips. */
+    struct _gol_domain_shared* shared;
+    size_t shared_size;
+
+    /* The two grids of each strip in the shared memory, the one of worker
+     * ``i`` for even generations at ``2 * i`` and for odd ones at
+     * ``2 * i + 1``. Each grid has the layout of
+     * :attr:`game_of_life_t.cells`, with a halo row above and below the
+     * strip. */
+    uint64_t** strips;
+
+    /* True if a worker died, after which the domain can only be
+     * destroyed. */
+    bool failed;
+} gol_domain_t;
+
+/* Create a domain of the specified size, split across *workers* worker
+ * processes. A value of zero starts one worker per online CPU; there are
+ * never more workers than rows. All cells are dead, and the rule is
+ * Conway's. Returns NULL if the memory could not be mapped or the
+ * processes could not be started. */
+gol_domain_t* gol_domain_create(
+        uint32_t width, uint32_t height, bool adjacency, uint32_t workers);
+
+/* Stop the worker processes and destroy the domain. */
+void gol_domain_destroy(gol_domain_t* domain);
+
+/* Set the rule from a rule string, see :func:`gol_rule_parse`. Returns
+ * false and leaves the rule unchanged if the string is not a valid rule. */
+bool gol_domain_set_rule(gol_domain_t* domain, const char* rule);
+
+/* Copy the cells, the rule and the generation of a game into the domain.
+ * Returns false if the game has a different size or a Larger than Life
+ * rule, or the domain failed. */
+bool gol_domain_import(gol_domain_t* domain, const game_of_life_t* game);
+
+/* Assemble the cells of all strips into a game, along with the rule and
+ * the generation of the domain. Returns false if the game has a different
+ * size or the domain failed. */
+bool gol_domain_export(const gol_domain_t* domain, game_of_life_t* game);
+
+/* Bring the domain *n* generations forward. Returns false if a worker
+ * died, in which case the domain is failed. */
+bool gol_domain_advance(gol_domain_t* domain, uint64_t n);
+
+#endif /* NIKLASROSENSTEIN_GAME_OF_LIFE_DOMAIN */
@@ -0,0 +1,159 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: golframe.c
+ * description: Frames of a Game of Life passed from a simulation thread
+ * author: Donkey Coding Group */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "golframe.h"
+#include "golprof.h"
+
+
+bool gol_frame_cell(const gol_frame_t* frame, int32_t x, int32_t y) {
+    if (x < 0 || y < 0 || (uint32_t) x >= frame->width ||
+            (uint32_t) y >= frame->height) {
+        return false;
+    }
+    uint64_t word = frame->cells[(size_t) y * frame->stride + x / 64];
+    return (word >> (x % 64)) & 1;
+}
+
+void gol_frame_capture(gol_frame_t* frame, const game_of_life_t* game) {
+    uint32_t y;
+    for (y=0; y < frame->height; y++) {
+        memcpy(frame->cells + (size_t) y * frame->stride,
+               game_of_life_row(game, y), sizeof(uint64_t) * frame->stride);
+    }
+    frame->generation = game->generation;
+    frame->stats = game->stats;
+    frame->period = game->period;
+}
+
+gol_triple_t* gol_triple_create(uint32_t width, uint32_t height) {
+    gol_triple_t* triple = calloc(1, sizeof(gol_triple_t));
+    uint32_t i;
+    if (triple == NULL) return NULL;
+
+    for (i=0; i < 3; i++) {
+        gol_frame_t* frame = &triple->frames[i];
+        frame->width = width;
+        frame->height = height;
+        frame->stride = (width + 63) / 64;
+        frame->cells = calloc((size_t) frame->stride * height, sizeof(uint64_t));
+        if (frame->cells == NULL) {
+            gol_triple_destroy(triple);
+            return NULL;
+        }
+    }
+    triple->front = 0;
+    triple->state = 1;
+    triple->back = 2;
+    return triple;
+}
+
+void gol_triple_destroy(gol_triple_t* triple) {
+    uint32_t i;
+    if (triple) {
+        for (i=0; i < 3; i++) free(triple->frames[i].cells);
+        free(triple);
+    }
+}
+
+gol_frame_t* gol_triple_back(gol_triple_t* triple) {
+    return &triple->frames[triple->back];
+}
+
+void gol_triple_publish(gol_triple_t* triple) {
+    uint32_t state = __atomic_exchange_n(
+            &triple->state, triple->back | GOL_TRIPLE_FRESH, __ATOMIC_ACQ_REL);
+    triple->back = state & 3;
+
+    /* A frame that is still fresh was never acquired. */
+    if (state & GOL_TRIPLE_FRESH) {
+        GOL_PROFILE_COUNT(GOL_COUNTER_FRAMES_DROPPED, 1);
+    }
+}
+
+const gol_frame_t* gol_triple_acquire(gol_triple_t* triple, bool* fresh) {
+    bool newer = __atomic_load_n(&triple->state, __ATOMIC_ACQUIRE) & GOL_TRIPLE_FRESH;
+    if (newer) {
+        uint32_t state = __atomic_exchange_n(
+                &triple->state, triple->front, __ATOMIC_ACQ_REL);
+        triple->front = state & 3;
+    }
+    if (fresh) *fresh = newer;
+    return &triple->frames[triple->front];
+}
+
+/* The main function of the thread of a runner. */
+static void* _gol_runner_main(void* arg) {
+    gol_runner_t* runner = arg;
+    game_of_life_t* game = runner->game;
+
+    gol_frame_capture(gol_triple_back(runner->frames), game);
+    gol_triple_publish(runner->frames);
+
+    while (!__atomic_load_n(&runner->stop, __ATOMIC_ACQUIRE)) {
+        if (runner->stop_on_cycle && game->period) break;
+
+        /* A cycle has nothing new to show, so the thread idles. */
+        usleep(game->period ? GOL_RUNNER_IDLE : runner->interval);
+
+        /* Large boards are calculated in slices, so that the runner stops
+         * without waiting for a whole generation. */
+        while (!game_of_life_step_partial(game, 0, GOL_RUNNER_SLICE)) {
+            if (__atomic_load_n(&runner->stop, __ATOMIC_ACQUIRE)) {
+                game_of_life_step_cancel(game);
+                return NULL;
+            }
+        }
+        gol_frame_capture(gol_triple_back(runner->frames), game);
+        gol_triple_publish(runner->frames);
+    }
+    return NULL;
+}
+
+gol_runner_t* gol_runner_start(
+        game_of_life_t* game, gol_triple_t* frames, uint32_t interval,
+        bool stop_on_cycle) {
+    gol_runner_t* runner = malloc(sizeof(gol_runner_t));
+    if (runner == NULL) return NULL;
+    runner->game = game;
+    runner->frames = frames;
+    runner->interval = interval;
+    runner->stop_on_cycle = stop_on_cycle;
+    runner->stop = false;
+    if (pthread_create(&runner->thread, NULL, _gol_runner_main, runner) != 0) {
+        free(runner);
+        return NULL;
+    }
+    return runner;
+}
+
+void gol_runner_stop(gol_runner_t* runner) {
+    if (runner) {
+        __atomic_store_n(&runner->stop, true, __ATOMIC_RELEASE);
+        pthread_join(runner->thread, NULL);
+        free(runner);
+    }
+}
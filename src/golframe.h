@@ -0,0 +1,136 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: golframe.h
+ * description: Frames of a Game of Life passed from a simulation thread
+ * author: Donkey Coding Group
+ *
+ * This C header defines frames, copies of the grid of a generation, and a
+ * lock-free triple buffer that passes them from the thread that calculates
+ * the generations to a thread that renders them. The simulation never waits
+ * for the renderer and the renderer never sees a frame that is still being
+ * written; frames that the renderer is too slow for are skipped. */
+
+#ifndef NIKLASROSENSTEIN_GAME_OF_LIFE_FRAME
+#define NIKLASROSENSTEIN_GAME_OF_LIFE_FRAME
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "gol.h"
+
+/* A copy of the grid and the statistics of a generation. */
+typedef struct gol_frame {
+    uint32_t width;
+    uint32_t height;
+    uint64_t generation;
+    gol_stats_t stats;
+    uint32_t period;
+
+    /* The bit-packed rows, *stride* words each, like the rows of
+     * :attr:`game_of_life_t.cells` but without halo words. */
+    uint32_t stride;
+    uint64_t* cells;
+} gol_frame_t;
+
+/* Three frames of the same size. The producer writes into the back frame
+ * and swaps it with the middle frame when it is complete, the consumer
+ * swaps the middle frame with its front frame when a newer one is there.
+ * *state* holds the index of the middle frame and GOL_TRIPLE_FRESH, and is
+ * only changed with atomic exchanges. *back* and *front* belong to the
+ * producer and the consumer. */
+typedef struct _gol_triple {
+    gol_frame_t frames[3];
+    uint32_t state;
+    uint32_t back;
+    uint32_t front;
+} gol_triple_t;
+
+/* Set in :attr:`gol_triple_t.state` if the middle frame has not been
+ * acquired yet. */
+#define GOL_TRIPLE_FRESH 4
+
+/* Returns the state of a cell of a frame, with the same rules for the
+ * coordinates as :func:`game_of_life_cell` on a grid without adjacency. */
+bool gol_frame_cell(const gol_frame_t* frame, int32_t x, int32_t y);
+
+/* Copy the grid and the statistics of a game into a frame of the same
+ * size. */
+void gol_frame_capture(gol_frame_t* frame, const game_of_life_t* game);
+
+/* Create a triple buffer of frames of the specified size. Returns NULL if
+ * memory allocation failed. */
+gol_triple_t* gol_triple_create(uint32_t width, uint32_t height);
+
+/* Destroy a triple buffer created with :func:`gol_triple_create`. */
+void gol_triple_destroy(gol_triple_t* triple);
+
+/* Returns the frame that the producer writes next. */
+gol_frame_t* gol_triple_back(gol_triple_t* triple);
+
+/* Publish the back frame as the latest one. Called by the producer. */
+void gol_triple_publish(gol_triple_t* triple);
+
+/* Returns the latest published frame, which stays valid until the next
+ * call. *fresh*, if not NULL, is set to whether it was published since
+ * the last call. Called by the consumer. */
+const gol_frame_t* gol_triple_acquire(gol_triple_t* triple, bool* fresh);
+
+/* The time between two generations of a runner in microseconds once the
+ * board entered a cycle. */
+#define GOL_RUNNER_IDLE (500 * 1000)
+
+/* The time in nanoseconds that a runner calculates a generation for before
+ * it checks whether it was stopped. */
+#define GOL_RUNNER_SLICE (10 * 1000 * 1000)
+
+/* A thread that calculates the generations of a game and publishes every
+ * generation into a triple buffer. */
+typedef struct _gol_runner {
+    game_of_life_t* game;
+    gol_triple_t* frames;
+
+    /* The time between two generations, in microseconds. */
+    uint32_t interval;
+
+    /* Stop calculating once the board entered a cycle. */
+    bool stop_on_cycle;
+
+    /* Set by :func:`gol_runner_stop`. */
+    bool stop;
+    pthread_t thread;
+} gol_runner_t;
+
+/* Start a thread that publishes the current generation of the game and
+ * then calculates and publishes a generation every *interval*
+ * microseconds, or every GOL_RUNNER_IDLE microseconds once the board
+ * entered a cycle, unless it stops then. The game must not be used
+ * elsewhere until the thread is stopped. Returns NULL if the thread could
+ * not be started. */
+gol_runner_t* gol_runner_start(
+        game_of_life_t* game, gol_triple_t* frames, uint32_t interval,
+        bool stop_on_cycle);
+
+/* Stop and join the thread and free the runner. A generation that was
+ * being calculated is abandoned, leaving the game at the last published
+ * one. */
+void gol_runner_stop(gol_runner_t* runner);
+
+#endif /* NIKLASROSENSTEIN_GAME_OF_LIFE_FRAME */
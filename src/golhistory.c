@@ -0,0 +1,275 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: golhistory.c
+ * description: Past generations of a Game of Life to rewind to
+ * author: Donkey Coding Group */
+
+#include <stdlib.h>
+#include <string.h>
+#include "golhistory.h"
+
+/* The largest number of words a run can skip or hold. */
+#define GOL_HISTORY_RUN_MAX UINT32_MAX
+
+
+/* Encodes the XOR of the grid of a game with the newest grid of the
+ * history, or with an empty grid for a keyframe, and returns its size in
+ * words. If *write* is false, only the size is calculated, else the words
+ * are written to *data* and the newest grid is replaced with the one of
+ * the game on the way. */
+static size_t _gol_history_encode(
+        gol_history_t* history, const game_of_life_t* game, bool keyframe,
+        bool write, uint64_t* data) {
+    uint32_t stride = history->stride;
+    size_t size = 0, skip = 0, header = 0;
+    uint32_t run = 0;
+    uint32_t y, w;
+
+    for (y=0; y < history->height; y++) {
+        const uint64_t* row = game_of_life_row(game, y);
+        uint64_t* last = history->last + (size_t) y * stride;
+        for (w=0; w < stride; w++) {
+            uint64_t word = keyframe ? row[w] : row[w] ^ last[w];
+            if (write) last[w] = row[w];
+            if (word == 0) {
+                run = 0;
+                skip++;
+                continue;
+            }
+
+            /* A new run starts after zero words and when a run is full. */
+            if (run == 0 || run == GOL_HISTORY_RUN_MAX) {
+                while (skip > GOL_HISTORY_RUN_MAX) {
+                    if (write) data[size] = (uint64_t) GOL_HISTORY_RUN_MAX << 32;
+                    size++;
+                    skip -= GOL_HISTORY_RUN_MAX;
+                }
+                header = size++;
+                if (write) data[header] = (uint64_t) skip << 32;
+                skip = 0;
+                run = 0;
+            }
+            if (write) {
+                data[header]++;
+                data[size] = word;
+            }
+            size++;
+            run++;
+        }
+    }
+    return size;
+}
+
+/* XORs the words of an entry onto a grid of rows *pitch* words apart. */
+static void _gol_history_apply(
+        const gol_history_t* history, const gol_history_entry_t* entry,
+        uint64_t* rows, size_t pitch) {
+    uint32_t stride = history->stride;
+    uint64_t y = 0, w = 0;
+    size_t i = 0;
+
+    while (i < entry->size) {
+        uint64_t header = entry->data[i++];
+        uint64_t skip = header >> 32;
+        uint32_t count = (uint32_t) header;
+        w += skip;
+        y += w / stride;
+        w %= stride;
+        while (count-- > 0) {
+            rows[y * pitch + w] ^= entry->data[i++];
+            if (++w == stride) {
+                w = 0;
+                y++;
+            }
+        }
+    }
+}
+
+/* Rebuilds the grid of entry *index* into a grid of rows *pitch* words
+ * apart from the keyframe before it. */
+static void _gol_history_rebuild(
+        const gol_history_t* history, uint32_t index, uint64_t* rows,
+        size_t pitch) {
+    uint32_t y, k = index;
+    while (!history->entries[k].keyframe) k--;
+    for (y=0; y < history->height; y++) {
+        memset(rows + (size_t) y * pitch, 0, sizeof(uint64_t) * history->stride);
+    }
+    for (; k <= index; k++) {
+        _gol_history_apply(history, &history->entries[k], rows, pitch);
+    }
+}
+
+/* Drops the entries from *index* on. */
+static void _gol_history_truncate(gol_history_t* history, uint32_t index) {
+    while (history->count > index) {
+        gol_history_entry_t* entry = &history->entries[--history->count];
+        history->used -= sizeof(uint64_t) * entry->size;
+        free(entry->data);
+    }
+}
+
+/* Drops the oldest keyframe and the generations after it, as long as the
+ * history exceeds its budget and another keyframe follows. */
+static void _gol_history_evict(gol_history_t* history) {
+    while (history->used > history->budget) {
+        uint32_t next = 1, i;
+        while (next < history->count && !history->entries[next].keyframe) next++;
+        if (next == history->count) break;
+        for (i=0; i < next; i++) {
+            history->used -= sizeof(uint64_t) * history->entries[i].size;
+            free(history->entries[i].data);
+        }
+        history->count -= next;
+        memmove(history->entries, history->entries + next,
+                sizeof(gol_history_entry_t) * history->count);
+    }
+}
+
+gol_history_t* gol_history_create(
+        uint32_t width, uint32_t height, size_t budget, uint32_t interval) {
+    if (width < 1 || height < 1) return NULL;
+    gol_history_t* history = calloc(1, sizeof(gol_history_t));
+    if (history == NULL) return NULL;
+    history->width = width;
+    history->height = height;
+    history->stride = (width + 63) / 64;
+    history->budget = budget;
+    history->interval = interval ? interval : GOL_HISTORY_DEFAULT_INTERVAL;
+    history->last = calloc((size_t) history->stride * height, sizeof(uint64_t));
+    if (history->last == NULL) {
+        free(history);
+        return NULL;
+    }
+    return history;
+}
+
+void gol_history_destroy(gol_history_t* history) {
+    if (history) {
+        _gol_history_truncate(history, 0);
+        free(history->entries);
+        free(history->last);
+        free(history);
+    }
+}
+
+bool gol_history_record(gol_history_t* history, const game_of_life_t* game) {
+    if (game->width != history->width || game->height != history->height) {
+        return false;
+    }
+    if (history->count == history->capacity) {
+        uint32_t capacity = history->capacity ? history->capacity * 2 : 64;
+        gol_history_entry_t* entries = realloc(
+                history->entries, sizeof(gol_history_entry_t) * capacity);
+        if (entries == NULL) return false;
+        history->entries = entries;
+        history->capacity = capacity;
+    }
+
+    /* A rewound game continues from an earlier generation, which replaces
+     * the ones that were recorded after it. */
+    uint32_t count = history->count;
+    while (count > 0 && history->entries[count - 1].generation >= game->generation) {
+        count--;
+    }
+
+    /* A keyframe is recorded after *interval* generations, and early if
+     * the history is over its budget, so that the old ones can go. After a
+     * rewind, the newest grid no longer matches the newest entry left, so
+     * a keyframe is recorded as well. */
+    uint32_t since = 0;
+    while (since < count && !history->entries[count - 1 - since].keyframe) since++;
+    bool keyframe = count == 0 || count != history->count ||
+                    since + 1 >= history->interval ||
+                    history->used > history->budget;
+
+    uint64_t* data = NULL;
+    size_t size = _gol_history_encode(history, game, keyframe, false, NULL);
+    if (size > 0) {
+        data = malloc(sizeof(uint64_t) * size);
+        if (data == NULL) return false;
+    }
+
+    _gol_history_truncate(history, count);
+    _gol_history_encode(history, game, keyframe, true, data);
+
+    gol_history_entry_t* entry = &history->entries[history->count++];
+    entry->generation = game->generation;
+    entry->stats = game->stats;
+    entry->keyframe = keyframe;
+    entry->size = size;
+    entry->data = data;
+    history->used += sizeof(uint64_t) * size;
+    _gol_history_evict(history);
+    return true;
+}
+
+bool gol_history_range(
+        const gol_history_t* history, uint64_t* oldest, uint64_t* newest) {
+    if (history->count == 0) return false;
+    *oldest = history->entries[0].generation;
+    *newest = history->entries[history->count - 1].generation;
+    return true;
+}
+
+bool gol_history_restore(
+        const gol_history_t* history, uint64_t generation,
+        game_of_life_t* game) {
+    if (game->width != history->width || game->height != history->height) {
+        return false;
+    }
+
+    /* The entries are ordered by generation. */
+    uint32_t low = 0, high = history->count;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (history->entries[mid].generation < generation) low = mid + 1;
+        else high = mid;
+    }
+    if (low == history->count || history->entries[low].generation != generation) {
+        return false;
+    }
+
+    /* Within the last keyframe's generations, the deltas can be undone
+     * from the newest grid as well, if that is closer. */
+    uint32_t index = low, newest = history->count - 1, k = index, i, y;
+    while (!history->entries[k].keyframe) k--;
+    for (i=index + 1; i <= newest && !history->entries[i].keyframe; i++);
+    uint64_t* rows = game_of_life_row(game, 0);
+    if (i > newest && newest - index < index - k) {
+        for (y=0; y < history->height; y++) {
+            memcpy(rows + (size_t) y * game->pitch,
+                   history->last + (size_t) y * history->stride,
+                   sizeof(uint64_t) * history->stride);
+        }
+        for (i=newest; i > index; i--) {
+            _gol_history_apply(history, &history->entries[i], rows, game->pitch);
+        }
+    }
+    else {
+        _gol_history_rebuild(history, index, rows, game->pitch);
+    }
+
+    game->generation = generation;
+    game->stats = history->entries[index].stats;
+    game_of_life_wake(game);
+    return true;
+}
@@ -0,0 +1,116 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: golhistory.h
+ * description: Past generations of a Game of Life to rewind to
+ * author: Donkey Coding Group
+ *
+ * This C header defines a history of the generations of a game, which any
+ * of them can be restored from. Every few generations a keyframe holds
+ * the whole grid, and the generations in between hold the words that
+ * changed since the one before them, as the XOR of both. Both are stored as
+ * runs of words that are not zero, so empty space and the parts of the
+ * board that did not change cost next to nothing. The oldest keyframes and
+ * the generations after them are dropped when the history exceeds its
+ * memory budget. */
+
+#ifndef NIKLASROSENSTEIN_GAME_OF_LIFE_HISTORY
+#define NIKLASROSENSTEIN_GAME_OF_LIFE_HISTORY
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "gol.h"
+
+/* The number of generations between two keyframes if none is specified. */
+#define GOL_HISTORY_DEFAULT_INTERVAL 32
+
+/* A generation of the history. *data* holds runs of *size* words in
+ * total: a word with the number of zero words to skip in its upper and the
+ * number of words that follow in its lower 32 bits, followed by those
+ * words. The words are XORed onto the grid of the generation before, or
+ * onto an empty grid for a keyframe. */
+typedef struct gol_history_entry {
+    uint64_t generation;
+    gol_stats_t stats;
+    bool keyframe;
+    size_t size;
+    uint64_t* data;
+} gol_history_entry_t;
+
+/* This structure represents the history of a game. */
+typedef struct _gol_history {
+    /* The size of the grids, and the number of words of a row. */
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+
+    /* The number of bytes that the entries may use, and the number they
+     * use. The newest keyframe and the generations after it are always
+     * kept. */
+    size_t budget;
+    size_t used;
+
+    /* The number of generations from one keyframe to the next. */
+    uint32_t interval;
+
+    /* The recorded generations, oldest first, starting with a keyframe. */
+    gol_history_entry_t* entries;
+    uint32_t count;
+    uint32_t capacity;
+
+    /* The grid of the newest entry, *stride* words per row, which the next
+     * one is compared with. */
+    uint64_t* last;
+} gol_history_t;
+
+/* Create a history for games of the specified size, whose entries use at
+ * most *budget* bytes in addition to a copy of the grid. A keyframe is
+ * recorded every *interval* generations, or every
+ * GOL_HISTORY_DEFAULT_INTERVAL if it is zero. Returns NULL if memory
+ * allocation failed or the size is invalid. */
+gol_history_t* gol_history_create(
+        uint32_t width, uint32_t height, size_t budget, uint32_t interval);
+
+/* Destroy a history created with :func:`gol_history_create`. */
+void gol_history_destroy(gol_history_t* history);
+
+/* Record the current generation of a game. If the history holds that or a
+ * later generation, which happens after a game was rewound, those are
+ * dropped first. Returns false if the game has a different size or memory
+ * allocation failed, which leaves the history as it was. */
+bool gol_history_record(gol_history_t* history, const game_of_life_t* game);
+
+/* Returns the oldest and the newest generation in the history in *oldest*
+ * and *newest*, or false if it is empty. Generations in between are only
+ * there if they were recorded. */
+bool gol_history_range(
+        const gol_history_t* history, uint64_t* oldest, uint64_t* newest);
+
+/* Restore a recorded generation into a game of the same size, along with
+ * the generation number and the statistics. The generation is rebuilt
+ * from the keyframe before it, or back from the newest one if that is
+ * closer, so the cost is bounded by the interval. Returns false if the
+ * generation is not in the history or the game has a different size. */
+bool gol_history_restore(
+        const gol_history_t* history, uint64_t generation,
+        game_of_life_t* game);
+
+#endif /* NIKLASROSENSTEIN_GAME_OF_LIFE_HISTORY */
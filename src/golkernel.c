@@ -0,0 +1,122 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: golkernel.c
+ * description: Row kernels for the Game of Life generation step
+ * author: Donkey Coding Group */
+
+#include <stdlib.h>
+#include <string.h>
+#include "golkernel.h"
+
+
+/* Returns the word *w* of a row shifted by one cell, so that each bit holds
+ * the state of its western neighbour. The halo word before the row holds
+ * the western neighbour of the first cell. */
+static inline uint64_t _gol_west(const uint64_t* row, uint32_t w) {
+    const uint64_t* word = row + w;
+    return (word[0] << 1) | (word[-1] >> 63);
+}
+
+/* Returns the word *w* of a row shifted by one cell, so that each bit holds
+ * the state of its eastern neighbour. */
+static inline uint64_t _gol_east(const uint64_t* row, uint32_t w) {
+    const uint64_t* word = row + w;
+    return (word[0] >> 1) | (word[1] << 63);
+}
+
+void gol_kernel_step_words(
+        const game_of_life_t* game, uint64_t* out, const uint64_t* above,
+        const uint64_t* row, const uint64_t* below, uint32_t begin,
+        uint32_t end) {
+    uint32_t w;
+    for (w=begin; w < end; w++) {
+        out[w] = gol_kernel_next_word(
+                _gol_west(above, w), above[w], _gol_east(above, w),
+                _gol_west(row, w), row[w], _gol_east(row, w),
+                _gol_west(below, w), below[w], _gol_east(below, w),
+                &game->compiled_rule);
+    }
+    if (end == game->stride) {
+        out[end - 1] &= gol_kernel_tail_mask(game->width);
+    }
+}
+
+/* The portable kernel, processing one word at a time. */
+static void _gol_kernel_scalar(
+        const game_of_life_t* game, uint64_t* out, const uint64_t* above,
+        const uint64_t* row, const uint64_t* below, uint32_t begin,
+        uint32_t end) {
+    gol_kernel_step_words(game, out, above, row, below, begin, end);
+}
+
+
+/* The vectorized kernels are instantiated from the same template for each
+ * instruction set and are only ever called if the CPU supports it. */
+#ifdef GOL_KERNEL_X86
+
+#define GOL_VECTOR_NAME _gol_kernel_sse2
+#define GOL_VECTOR_TARGET "sse2"
+#define GOL_VECTOR_LANES 2
+#include "golkernel_vector.inc"
+
+#define GOL_VECTOR_NAME _gol_kernel_avx2
+#define GOL_VECTOR_TARGET "avx2"
+#define GOL_VECTOR_LANES 4
+#include "golkernel_vector.inc"
+
+#define GOL_VECTOR_NAME _gol_kernel_avx512
+#define GOL_VECTOR_TARGET "avx512f"
+#define GOL_VECTOR_LANES 8
+#include "golkernel_vector.inc"
+
+#endif /* GOL_KERNEL_X86 */
+
+
+game_of_life_row_kernel_t gol_kernel_lookup(GOL_KERNEL kernel) {
+#ifdef GOL_KERNEL_X86
+    __builtin_cpu_init();
+#endif
+    switch (kernel) {
+        case GOL_KERNEL_SCALAR:
+            return _gol_kernel_scalar;
+#ifdef GOL_KERNEL_X86
+        case GOL_KERNEL_SSE2:
+            if (__builtin_cpu_supports("sse2")) return _gol_kernel_sse2;
+            break;
+        case GOL_KERNEL_AVX2:
+            if (__builtin_cpu_supports("avx2")) return _gol_kernel_avx2;
+            break;
+        case GOL_KERNEL_AVX512:
+            if (__builtin_cpu_supports("avx512f")) return _gol_kernel_avx512;
+            break;
+#endif
+        default:
+            break;
+    }
+    return NULL;
+}
+
+GOL_KERNEL gol_kernel_detect(void) {
+    if (gol_kernel_lookup(GOL_KERNEL_AVX512)) return GOL_KERNEL_AVX512;
+    if (gol_kernel_lookup(GOL_KERNEL_AVX2)) return GOL_KERNEL_AVX2;
+    if (gol_kernel_lookup(GOL_KERNEL_SSE2)) return GOL_KERNEL_SSE2;
+    return GOL_KERNEL_SCALAR;
+}
@@ -0,0 +1,169 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: golkernel.h
+ * description: Row kernels for the Game of Life generation step
+ * author: Donkey Coding Group
+ *
+ * This C header declares the kernels that calculate the next generation of
+ * a row of the bit-packed grid, and the CPU feature detection that selects
+ * between them. It is internal to the Game of Life implementation. */
+
+#ifndef NIKLASROSENSTEIN_GAME_OF_LIFE_KERNEL
+#define NIKLASROSENSTEIN_GAME_OF_LIFE_KERNEL
+
+#include "gol.h"
+
+/* Defined if the vectorized kernels for x86 CPUs can be compiled. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GOL_KERNEL_X86
+#endif
+
+/* Returns the bit mask of the valid cells in the last word of a row. */
+static inline uint64_t gol_kernel_tail_mask(uint32_t width) {
+    uint32_t bits = width % 64;
+    return bits ? (((uint64_t) 1 << bits) - 1) : ~(uint64_t) 0;
+}
+
+/* Fills the halo words of a row with the cells of the opposite edge if
+ * adjacency is enabled, or with zeros. If the width is not a multiple of
+ * 64, the eastern neighbour of the last column is the first unused bit of
+ * its word, which is set as well and must be cleared afterwards. */
+static inline void gol_kernel_fill_row_halo(
+        const game_of_life_t* game, uint64_t* row) {
+    uint32_t stride = game->stride;
+    uint32_t last = game->width - 1;
+    uint32_t tail = game->width % 64;
+
+    if (!game->adjacency) {
+        row[-1] = 0;
+        row[stride] = 0;
+        return;
+    }
+
+    uint64_t first = row[0] & 1;
+    row[-1] = (row[last / 64] >> (last % 64)) << 63;
+    if (tail) {
+        row[stride - 1] |= first << tail;
+        row[stride] = 0;
+    }
+    else {
+        row[stride] = first;
+    }
+}
+
+/* Returns the number of set bits of *x*. Without a popcount instruction,
+ * GCC's builtin is a library call, which is slower than counting in
+ * registers. */
+static inline int gol_kernel_popcount(uint64_t x) {
+#ifdef __POPCNT__
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ull);
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return (int) ((x * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+/* Bitwise full adder. Adds the bits of *a*, *b* and *c* in parallel. */
+static inline void gol_kernel_full_add(
+        uint64_t a, uint64_t b, uint64_t c, uint64_t* sum, uint64_t* carry) {
+    uint64_t t = a ^ b;
+    *sum = t ^ c;
+    *carry = (a & b) | (t & c);
+}
+
+/* Evaluates a compiled rule, see :class:`gol_rule_compiled_t`, for the
+ * cells *r*, whose neighbour counts are given as the bit planes *n1*, *n2*,
+ * *n4* and *n8*. The vectorized kernels use the same expression on their
+ * vectors. The counts select the result through a tree of multiplexers,
+ * which costs the same for any rule; a count of eight is the only one with
+ * *n8* set, and all lower planes are zero for it. */
+#define GOL_KERNEL_RULE_LEAF(r, base, flip, i) ((base)[i] ^ ((r) & (flip)[i]))
+#define GOL_KERNEL_MUX(s, lo, hi) ((lo) ^ ((s) & ((lo) ^ (hi))))
+#define GOL_KERNEL_APPLY_RULE(r, n1, n2, n4, n8, base, flip) \
+    GOL_KERNEL_MUX((n4), \
+        GOL_KERNEL_MUX((n2), \
+            GOL_KERNEL_RULE_LEAF(r, base, flip, 0) \
+                ^ ((n1) & GOL_KERNEL_RULE_LEAF(r, base, flip, 1)) \
+                ^ ((n8) & GOL_KERNEL_RULE_LEAF(r, base, flip, 8)), \
+            GOL_KERNEL_RULE_LEAF(r, base, flip, 2) \
+                ^ ((n1) & GOL_KERNEL_RULE_LEAF(r, base, flip, 3))), \
+        GOL_KERNEL_MUX((n2), \
+            GOL_KERNEL_RULE_LEAF(r, base, flip, 4) \
+                ^ ((n1) & GOL_KERNEL_RULE_LEAF(r, base, flip, 5)), \
+            GOL_KERNEL_RULE_LEAF(r, base, flip, 6) \
+                ^ ((n1) & GOL_KERNEL_RULE_LEAF(r, base, flip, 7))))
+
+/* Applies a compiled rule to the cells of a word, see
+ * GOL_KERNEL_APPLY_RULE. */
+static inline uint64_t gol_kernel_apply_rule(
+        uint64_t r, uint64_t n1, uint64_t n2, uint64_t n4, uint64_t n8,
+        const gol_rule_compiled_t* rule) {
+    return GOL_KERNEL_APPLY_RULE(r, n1, n2, n4, n8, rule->base, rule->flip);
+}
+
+/* Returns the next generation of the 64 cells of the word *r*. The other
+ * words hold the neighbours of each cell at the same bit: the row above
+ * (a), the row itself (r) and the row below (b), each shifted by one cell
+ * to the west (w) and to the east (e). */
+static inline uint64_t gol_kernel_next_word(
+        uint64_t aw, uint64_t a, uint64_t ae, uint64_t rw, uint64_t r,
+        uint64_t re, uint64_t bw, uint64_t b, uint64_t be,
+        const gol_rule_compiled_t* rule) {
+    uint64_t s0, c0, s1, c1, s2, c2, c3, t0, d0, d1;
+
+    /* Add up the eight neighbours of each cell into the bit planes of a
+     * four bit counter. */
+    gol_kernel_full_add(aw, a, ae, &s0, &c0);
+    gol_kernel_full_add(bw, b, be, &s1, &c1);
+    s2 = rw ^ re;
+    c2 = rw & re;
+
+    uint64_t n1, n2, n4, n8;
+    gol_kernel_full_add(s0, s1, s2, &n1, &c3);
+    gol_kernel_full_add(c0, c1, c2, &t0, &d0);
+    n2 = t0 ^ c3;
+    d1 = t0 & c3;
+    n4 = d0 ^ d1;
+    n8 = d0 & d1;
+
+    return gol_kernel_apply_rule(r, n1, n2, n4, n8, rule);
+}
+
+/* Returns the row kernel for the specified identifier, or NULL if it is not
+ * supported by the CPU. GOL_KERNEL_AUTO is not resolved by this function,
+ * use :func:`gol_kernel_detect` for that. */
+game_of_life_row_kernel_t gol_kernel_lookup(GOL_KERNEL kernel);
+
+/* Returns the widest kernel that is supported by the CPU. */
+GOL_KERNEL gol_kernel_detect(void);
+
+/* Calculates the words [begin, end) of the next generation of a row with
+ * portable scalar code. The rows must be surrounded by their halo words,
+ * see :class:`game_of_life_t`. The vectorized kernels use this for the
+ * words at the end of the range that don't fill a vector. */
+void gol_kernel_step_words(
+        const game_of_life_t* game, uint64_t* out, const uint64_t* above,
+        const uint64_t* row, const uint64_t* below, uint32_t begin,
+        uint32_t end);
+
+#endif /* NIKLASROSENSTEIN_GAME_OF_LIFE_KERNEL */
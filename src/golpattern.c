@@ -0,0 +1,536 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: golpattern.c
+ * description: Reading and writing patterns in the common file formats
+ * author: Donkey Coding Group */
+
+#include <stdlib.h>
+#include <string.h>
+#include "golpattern.h"
+#include "golprof.h"
+
+/* The size of the buffers that patterns are read and written through. */
+#define GOL_PATTERN_BUFFER (64 * 1024)
+
+/* The longest lines of an RLE file that are written. */
+#define GOL_PATTERN_RLE_LINE 70
+
+/* Longer runs and coordinates than this are rejected as malformed. */
+#define GOL_PATTERN_MAX_RUN ((int64_t) 1 << 40)
+
+
+/* A buffered reader of a pattern file. */
+typedef struct gol_reader {
+    FILE* fp;
+    size_t pos;
+    size_t len;
+    unsigned char data[GOL_PATTERN_BUFFER];
+} gol_reader_t;
+
+/* Fills the buffer of the reader. Returns false at the end of the file. */
+static bool _gol_reader_fill(gol_reader_t* reader) {
+    reader->pos = 0;
+    reader->len = fread(reader->data, 1, sizeof(reader->data), reader->fp);
+    return reader->len > 0;
+}
+
+/* Returns the next character without consuming it, or EOF. */
+static inline int _gol_reader_peek(gol_reader_t* reader) {
+    if (reader->pos == reader->len && !_gol_reader_fill(reader)) return EOF;
+    return reader->data[reader->pos];
+}
+
+/* Returns and consumes the next character, or EOF. */
+static inline int _gol_reader_get(gol_reader_t* reader) {
+    if (reader->pos == reader->len && !_gol_reader_fill(reader)) return EOF;
+    return reader->data[reader->pos++];
+}
+
+/* Consumes the rest of the line, including its end. */
+static void _gol_reader_skip_line(gol_reader_t* reader) {
+    while (reader->pos < reader->len || _gol_reader_fill(reader)) {
+        unsigned char* data = reader->data + reader->pos;
+        unsigned char* end = memchr(data, '\n', reader->len - reader->pos);
+        if (end) {
+            reader->pos += end - data + 1;
+            return;
+        }
+        reader->pos = reader->len;
+    }
+}
+
+/* Reads the rest of the line into *line*, which holds *size* characters.
+ * Longer lines are truncated. */
+static void _gol_reader_line(gol_reader_t* reader, char* line, size_t size) {
+    size_t len = 0;
+    int c;
+    while ((c = _gol_reader_get(reader)) != EOF && c != '\n') {
+        if (len + 1 < size) line[len++] = c;
+    }
+    if (len > 0 && line[len - 1] == '\r') len--;
+    line[len] = '\0';
+}
+
+/* Returns true if *c* is a space, a tab or the end of a line. */
+static inline bool _gol_space(int c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/* Detects the format from the start of the file, which is in the buffer
+ * of the reader. */
+static GOL_PATTERN_FORMAT _gol_pattern_detect(gol_reader_t* reader) {
+    const char* data = (const char*) reader->data;
+    size_t len = reader->len;
+    size_t i = 0;
+
+    if (len >= 10 && memcmp(data, "#Life 1.06", 10) == 0) {
+        return GOL_PATTERN_LIFE106;
+    }
+
+    /* The first line that is not a comment is the header of an RLE file,
+     * or the first row of a plaintext file. */
+    while (i < len) {
+        if (data[i] == '!') return GOL_PATTERN_PLAINTEXT;
+        if (data[i] == '#') {
+            const char* end = memchr(data + i, '\n', len - i);
+            if (end == NULL) break;
+            i = end - data + 1;
+            continue;
+        }
+        while (i < len && (data[i] == ' ' || data[i] == '\t')) i++;
+        if (i < len && data[i] == 'x') return GOL_PATTERN_RLE;
+        break;
+    }
+    return GOL_PATTERN_PLAINTEXT;
+}
+
+/* Draws *n* living cells of the pattern from *x*, *y* on, with 64-bit
+ * coordinates that may lie far outside of the grid. */
+static void _gol_pattern_span(
+        const game_of_life_t* game, int64_t x, int64_t y, int64_t n) {
+    if (game->adjacency) {
+        x %= (int64_t) game->width;
+        y %= (int64_t) game->height;
+    }
+    else {
+        if (y < 0 || y >= game->height || x >= game->width || x + n <= 0) {
+            return;
+        }
+        if (x < 0) {
+            n += x;
+            x = 0;
+        }
+    }
+    game_of_life_draw_span(game, (int32_t) x, (int32_t) y, n, true);
+}
+
+/* Parses the header line of an RLE file, such as
+ * "x = 36, y = 9, rule = B3/S23". */
+static bool _gol_pattern_rle_header(char* line, gol_pattern_info_t* info) {
+    char* s = line;
+    bool has_x = false, has_y = false;
+
+    while (*s) {
+        while (_gol_space(*s) || *s == ',') s++;
+        if (!*s) break;
+
+        char* key = s;
+        while (*s && *s != '=' && !_gol_space(*s)) s++;
+        size_t key_len = s - key;
+        while (_gol_space(*s)) s++;
+        if (*s++ != '=') return false;
+        while (_gol_space(*s)) s++;
+        char* value = s;
+
+        /* The rule comes last, and Larger than Life rules contain commas. */
+        bool rule = key_len == 4 && memcmp(key, "rule", 4) == 0;
+        while (*s && (rule || *s != ',')) s++;
+        char* end = s;
+        while (end > value && _gol_space(end[-1])) end--;
+        if (*s) s++;
+        *end = '\0';
+
+        if (key_len == 1 && (*key == 'x' || *key == 'y')) {
+            char* rest;
+            unsigned long size = strtoul(value, &rest, 10);
+            if (rest == value || *rest || size > UINT32_MAX) return false;
+            if (*key == 'x') info->width = size, has_x = true;
+            else info->height = size, has_y = true;
+        }
+        else if (rule) {
+            /* Golly appends the shape of a bounded grid, such as ":T100,100",
+             * which is not part of the rule. */
+            char* shape = strchr(value, ':');
+            if (shape) *shape = '\0';
+            info->has_rule = gol_rule_parse(value, &info->rule);
+            if (!info->has_rule) gol_ltl_rule_parse(value, &info->ltl);
+        }
+    }
+    return has_x && has_y;
+}
+
+/* Reads the header and the cells of an RLE file. */
+static bool _gol_pattern_read_rle(
+        const game_of_life_t* game, gol_reader_t* reader, int64_t x, int64_t y,
+        gol_pattern_info_t* info) {
+    char line[256];
+    int64_t run = 0, col = 0, row = 0;
+    int c;
+
+    /* Comment lines precede the header. */
+    for (;;) {
+        while ((c = _gol_reader_peek(reader)) != EOF && _gol_space(c)) {
+            _gol_reader_get(reader);
+        }
+        if (c == '#') {
+            _gol_reader_skip_line(reader);
+            continue;
+        }
+        if (c != 'x') return false;
+        _gol_reader_line(reader, line, sizeof(line));
+        if (!_gol_pattern_rle_header(line, info)) return false;
+        break;
+    }
+
+    while ((c = _gol_reader_get(reader)) != EOF) {
+        if (c >= '0' && c <= '9') {
+            run = run * 10 + (c - '0');
+            if (run > GOL_PATTERN_MAX_RUN) return false;
+            continue;
+        }
+        int64_t count = run ? run : 1;
+        run = 0;
+
+        switch (c) {
+            case ' ': case '\t': case '\r': case '\n':
+                break;
+            case '#':
+                _gol_reader_skip_line(reader);
+                break;
+            case 'b': case '.':
+                col += count;
+                break;
+            case '$':
+                row += count;
+                col = 0;
+                break;
+            case '!':
+                return true;
+            default:
+                /* Any other letter is a living cell, as in the files of
+                 * automata with more than two states. */
+                if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))) {
+                    return false;
+                }
+                _gol_pattern_span(game, x + col, y + row, count);
+                col += count;
+                break;
+        }
+        if (col > GOL_PATTERN_MAX_RUN || row > GOL_PATTERN_MAX_RUN) return false;
+    }
+    return true;
+}
+
+/* Reads the rows of a plaintext file. */
+static bool _gol_pattern_read_plaintext(
+        const game_of_life_t* game, gol_reader_t* reader, int64_t x, int64_t y,
+        gol_pattern_info_t* info) {
+    int64_t col = 0, row = 0, start = -1;
+    uint32_t width = 0;
+    int c;
+
+    for (;;) {
+        c = _gol_reader_get(reader);
+        if (c == '!' && col == 0) {
+            _gol_reader_skip_line(reader);
+            continue;
+        }
+
+        bool living = (c == 'O' || c == 'o' || c == '*' || c == 'X' || c == 'x');
+        if (living) {
+            if (start < 0) start = col;
+            col++;
+            continue;
+        }
+
+        /* The run of living cells ends. */
+        if (start >= 0) {
+            _gol_pattern_span(game, x + start, y + row, col - start);
+            start = -1;
+        }
+
+        if (c == '.' || c == ' ' || c == '\t') {
+            col++;
+        }
+        else if (c == '\n' || c == EOF) {
+            if (col > width) width = col > UINT32_MAX ? UINT32_MAX : col;
+            if (col > 0 || c == '\n') row++;
+            if (c == EOF) break;
+            col = 0;
+        }
+        else if (c != '\r') {
+            return false;
+        }
+        if (col > GOL_PATTERN_MAX_RUN || row > GOL_PATTERN_MAX_RUN) return false;
+    }
+
+    info->width = width;
+    info->height = row > UINT32_MAX ? UINT32_MAX : row;
+    return true;
+}
+
+/* Reads an integer of a Life 1.06 coordinate, after any spaces. */
+static bool _gol_pattern_integer(gol_reader_t* reader, int64_t* value) {
+    bool negative = false;
+    int64_t result = 0;
+    int c;
+
+    while ((c = _gol_reader_peek(reader)) == ' ' || c == '\t') {
+        _gol_reader_get(reader);
+    }
+    if (c == '-' || c == '+') {
+        negative = (c == '-');
+        _gol_reader_get(reader);
+        c = _gol_reader_peek(reader);
+    }
+    if (c < '0' || c > '9') return false;
+    while ((c = _gol_reader_peek(reader)) >= '0' && c <= '9') {
+        result = result * 10 + (c - '0');
+        if (result > GOL_PATTERN_MAX_RUN) return false;
+        _gol_reader_get(reader);
+    }
+    *value = negative ? -result : result;
+    return true;
+}
+
+/* Reads the coordinates of a Life 1.06 file. */
+static bool _gol_pattern_read_life106(
+        const game_of_life_t* game, gol_reader_t* reader, int64_t x, int64_t y,
+        gol_pattern_info_t* info) {
+    int64_t min_x = 0, min_y = 0, max_x = -1, max_y = -1;
+    int c;
+
+    while ((c = _gol_reader_peek(reader)) != EOF) {
+        if (c == '#' || _gol_space(c)) {
+            if (c == '#') _gol_reader_skip_line(reader);
+            else _gol_reader_get(reader);
+            continue;
+        }
+
+        int64_t cx, cy;
+        if (!_gol_pattern_integer(reader, &cx) ||
+                !_gol_pattern_integer(reader, &cy)) {
+            return false;
+        }
+        _gol_pattern_span(game, x + cx, y + cy, 1);
+
+        if (max_x < min_x) {
+            min_x = max_x = cx;
+            min_y = max_y = cy;
+        }
+        if (cx < min_x) min_x = cx;
+        if (cx > max_x) max_x = cx;
+        if (cy < min_y) min_y = cy;
+        if (cy > max_y) max_y = cy;
+
+        while ((c = _gol_reader_peek(reader)) == ' ' || c == '\t' || c == '\r') {
+            _gol_reader_get(reader);
+        }
+        if (c != '\n' && c != EOF) return false;
+    }
+
+    if (max_x >= min_x) {
+        info->min_x = min_x < INT32_MIN ? INT32_MIN : min_x;
+        info->min_y = min_y < INT32_MIN ? INT32_MIN : min_y;
+        info->width = max_x - min_x + 1 > UINT32_MAX ? UINT32_MAX : max_x - min_x + 1;
+        info->height = max_y - min_y + 1 > UINT32_MAX ? UINT32_MAX : max_y - min_y + 1;
+    }
+    return true;
+}
+
+bool gol_pattern_read(
+        const game_of_life_t* game, FILE* fp, GOL_PATTERN_FORMAT format,
+        int32_t x, int32_t y, gol_pattern_info_t* info) {
+    gol_pattern_info_t local;
+    if (info == NULL) info = &local;
+    memset(info, 0, sizeof(*info));
+
+    gol_reader_t* reader = malloc(sizeof(gol_reader_t));
+    if (reader == NULL) return false;
+    reader->fp = fp;
+    _gol_reader_fill(reader);
+
+    if (format == GOL_PATTERN_AUTO) {
+        format = _gol_pattern_detect(reader);
+    }
+    info->format = format;
+
+    bool success = false;
+    switch (format) {
+        case GOL_PATTERN_RLE:
+            success = _gol_pattern_read_rle(game, reader, x, y, info);
+            break;
+        case GOL_PATTERN_PLAINTEXT:
+            success = _gol_pattern_read_plaintext(game, reader, x, y, info);
+            break;
+        case GOL_PATTERN_LIFE106:
+            success = _gol_pattern_read_life106(game, reader, x, y, info);
+            break;
+        case GOL_PATTERN_AUTO:
+        default:
+            break;
+    }
+
+    if (ferror(fp)) success = false;
+    free(reader);
+    return success;
+}
+
+bool gol_pattern_load(
+        const game_of_life_t* game, const char* filename,
+        GOL_PATTERN_FORMAT format, int32_t x, int32_t y,
+        gol_pattern_info_t* info) {
+    FILE* fp = fopen(filename, "rb");
+    if (fp == NULL) return false;
+    bool success = gol_pattern_read(game, fp, format, x, y, info);
+    fclose(fp);
+    return success;
+}
+
+
+/* A buffered writer of an RLE file. */
+typedef struct gol_writer {
+    FILE* fp;
+    bool ok;
+    size_t len;
+
+    /* The length of the current line of the file. */
+    size_t line;
+    char data[GOL_PATTERN_BUFFER];
+} gol_writer_t;
+
+/* Writes the buffer of the writer to the file. */
+static void _gol_writer_flush(gol_writer_t* writer) {
+    if (writer->len == 0) return;
+    GOL_PROFILE_BEGIN(start);
+    if (fwrite(writer->data, 1, writer->len, writer->fp) != writer->len) {
+        writer->ok = false;
+    }
+    GOL_PROFILE_COUNT(GOL_COUNTER_BYTES, writer->len);
+    GOL_PROFILE_END(start, GOL_PHASE_IO);
+    writer->len = 0;
+}
+
+/* Appends *len* characters to the file. */
+static void _gol_writer_put(gol_writer_t* writer, const char* s, size_t len) {
+    if (writer->len + len > sizeof(writer->data)) _gol_writer_flush(writer);
+    memcpy(writer->data + writer->len, s, len);
+    writer->len += len;
+}
+
+/* Appends a run of *count* times the tag *c*, starting a new line if the
+ * current one would become too long. */
+static void _gol_writer_run(gol_writer_t* writer, uint64_t count, char c) {
+    char token[24];
+    size_t len = sizeof(token);
+    token[--len] = c;
+    if (count > 1) {
+        while (count) {
+            token[--len] = '0' + count % 10;
+            count /= 10;
+        }
+    }
+    size_t size = sizeof(token) - len;
+    if (writer->line + size > GOL_PATTERN_RLE_LINE) {
+        _gol_writer_put(writer, "\n", 1);
+        writer->line = 0;
+    }
+    _gol_writer_put(writer, token + len, size);
+    writer->line += size;
+}
+
+/* Returns the first column from *x* on whose cell has the specified state,
+ * or the width of the grid if there is none. */
+static uint32_t _gol_pattern_find(
+        const game_of_life_t* game, const uint64_t* row, uint32_t x, bool state) {
+    uint64_t flip = state ? 0 : ~(uint64_t) 0;
+    uint32_t w = x / 64;
+    if (x >= game->width) return game->width;
+
+    uint64_t word = (row[w] ^ flip) & (~(uint64_t) 0 << (x % 64));
+    while (word == 0) {
+        if (++w >= game->stride) return game->width;
+        word = row[w] ^ flip;
+    }
+    x = w * 64 + __builtin_ctzll(word);
+    return x < game->width ? x : game->width;
+}
+
+bool gol_pattern_write_rle(const game_of_life_t* game, FILE* fp) {
+    char rule[GOL_LTL_RULE_STRING_SIZE];
+    uint64_t rows = 0;
+    uint32_t y;
+
+    gol_writer_t* writer = malloc(sizeof(gol_writer_t));
+    if (writer == NULL) return false;
+    writer->fp = fp;
+    writer->ok = true;
+    writer->len = 0;
+    writer->line = 0;
+
+    int len = snprintf(writer->data, sizeof(writer->data),
+                       "x = %u, y = %u, rule = %s\n", game->width,
+                       game->height, game->ltl.range
+                           ? gol_ltl_rule_format(game->ltl, rule)
+                           : gol_rule_format(game->rule, rule));
+    writer->len = len;
+
+    /* Runs of living and dead cells are found a word at a time. Dead cells
+     * at the end of a row and empty rows at the end are left out. */
+    for (y=0; y < game->height; y++, rows++) {
+        const uint64_t* row = game_of_life_row(game, y);
+        uint32_t x = _gol_pattern_find(game, row, 0, true);
+        uint32_t end = 0;
+        if (x == game->width) continue;
+        if (rows) _gol_writer_run(writer, rows, '$');
+        rows = 0;
+        while (x < game->width) {
+            if (x > end) _gol_writer_run(writer, x - end, 'b');
+            end = _gol_pattern_find(game, row, x, false);
+            _gol_writer_run(writer, end - x, 'o');
+            x = _gol_pattern_find(game, row, end, true);
+        }
+    }
+    _gol_writer_put(writer, "!\n", 2);
+    _gol_writer_flush(writer);
+
+    bool success = writer->ok;
+    free(writer);
+    return success;
+}
+
+bool gol_pattern_save_rle(const game_of_life_t* game, const char* filename) {
+    FILE* fp = fopen(filename, "wb");
+    if (fp == NULL) return false;
+    bool success = gol_pattern_write_rle(game, fp);
+    if (fclose(fp) != 0) success = false;
+    return success;
+}
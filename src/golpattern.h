@@ -0,0 +1,110 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: golpattern.h
+ * description: Reading and writing patterns in the common file formats
+ * author: Donkey Coding Group
+ *
+ * This C header defines functions that read patterns in the RLE, plaintext
+ * (.cells) and Life 1.06 formats into a Game of Life and write the grid of
+ * a Game of Life in the RLE format. Files are read and written through a
+ * buffer, one pass only, and runs of living cells are drawn as whole spans
+ * of words, so that even huge patterns load about as fast as they are
+ * read. */
+
+#ifndef NIKLASROSENSTEIN_GAME_OF_LIFE_PATTERN
+#define NIKLASROSENSTEIN_GAME_OF_LIFE_PATTERN
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "gol.h"
+#include "golrule.h"
+
+/* The formats of pattern files. */
+typedef enum GOL_PATTERN_FORMAT {
+    /* Detect the format from the start of the file. */
+    GOL_PATTERN_AUTO = 0,
+
+    /* The run length encoded format, with a "x = 3, y = 3" header line,
+     * "b" for dead, "o" for living cells and "$" for the end of a row. */
+    GOL_PATTERN_RLE,
+
+    /* One line per row, with "." for dead and "O" for living cells, and
+     * comment lines starting with "!". */
+    GOL_PATTERN_PLAINTEXT,
+
+    /* A "#Life 1.06" line followed by the coordinates of the living cells,
+     * one pair per line. */
+    GOL_PATTERN_LIFE106,
+} GOL_PATTERN_FORMAT;
+
+/* Information about a pattern that was read. */
+typedef struct gol_pattern_info {
+    /* The format of the file. */
+    GOL_PATTERN_FORMAT format;
+
+    /* The extent of the pattern. For RLE files this is the size from the
+     * header line, otherwise the size of the rows that were read, or the
+     * bounding box of the coordinates of a Life 1.06 file. */
+    uint32_t width;
+    uint32_t height;
+
+    /* Life 1.06 coordinates are relative to the centre of the pattern.
+     * This is the coordinate of the top-left corner of the bounding box,
+     * zero for the other formats. */
+    int32_t min_x;
+    int32_t min_y;
+
+    /* The rule of the header line of an RLE file. *has_rule* is false if
+     * the file does not specify a rule or the rule is not Life-like. The
+     * range of *ltl* is not zero if the rule is a Larger than Life rule,
+     * see :func:`gol_ltl_rule_parse`. */
+    bool has_rule;
+    gol_rule_t rule;
+    gol_ltl_rule_t ltl;
+} gol_pattern_info_t;
+
+/* Read a pattern from *fp* and draw its living cells into the game, with
+ * the top-left corner of the pattern at *x*, *y* (or the origin of the
+ * coordinates of a Life 1.06 file). The cells wrap around the edges like
+ * with :func:`game_of_life_cell_set`, dead cells of the pattern leave the
+ * grid unchanged. The rule of the file is only reported in *info*, which
+ * may be NULL. Returns false if the file is malformed, in which case the
+ * cells up to the error have been drawn. */
+bool gol_pattern_read(
+        const game_of_life_t* game, FILE* fp, GOL_PATTERN_FORMAT format,
+        int32_t x, int32_t y, gol_pattern_info_t* info);
+
+/* Like :func:`gol_pattern_read`, reading from the file *filename*. */
+bool gol_pattern_load(
+        const game_of_life_t* game, const char* filename,
+        GOL_PATTERN_FORMAT format, int32_t x, int32_t y,
+        gol_pattern_info_t* info);
+
+/* Write the grid of the game to *fp* in the RLE format, with the size of
+ * the grid and the rule of the game in the header line. Returns false if
+ * writing failed. */
+bool gol_pattern_write_rle(const game_of_life_t* game, FILE* fp);
+
+/* Like :func:`gol_pattern_write_rle`, writing to the file *filename*. */
+bool gol_pattern_save_rle(const game_of_life_t* game, const char* filename);
+
+#endif /* NIKLASROSENSTEIN_GAME_OF_LIFE_PATTERN */
@@ -0,0 +1,182 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: golpool.c
+ * description: Persistent worker thread pool
+ * author: Donkey Coding Group */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "golpool.h"
+
+
+struct _gol_pool {
+    uint32_t size;
+    pthread_t* threads;
+
+    pthread_mutex_t lock;
+
+    /* Signalled when a new task is published. Workers wait for the
+     * *ticket* to change. */
+    pthread_cond_t start;
+    uint64_t ticket;
+    gol_pool_task_t task;
+    void* arg;
+    bool stop;
+
+    /* The barrier at the end of a task. *pending* counts the threads that
+     * have not arrived yet, the last one signals *done*. */
+    pthread_cond_t done;
+    uint32_t pending;
+};
+
+/* Per-thread start parameters. */
+typedef struct _gol_pool_worker {
+    gol_pool_t* pool;
+    uint32_t index;
+} gol_pool_worker_t;
+
+
+/* Arrive at the barrier at the end of a task. */
+static void _gol_pool_arrive(gol_pool_t* pool) {
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->pending == 0) {
+        pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void* _gol_pool_main(void* param) {
+    gol_pool_worker_t worker = *(gol_pool_worker_t*) param;
+    gol_pool_t* pool = worker.pool;
+    free(param);
+
+    uint64_t ticket = 0;
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->ticket == ticket && !pool->stop) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->stop) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        ticket = pool->ticket;
+        gol_pool_task_t task = pool->task;
+        void* arg = pool->arg;
+        pthread_mutex_unlock(&pool->lock);
+
+        task(arg, worker.index, pool->size);
+        _gol_pool_arrive(pool);
+    }
+    return NULL;
+}
+
+/* Stop the first *count* worker threads and free the pool. */
+static void _gol_pool_shutdown(gol_pool_t* pool, uint32_t count) {
+    uint32_t i;
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (i=0; i < count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->start);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool);
+}
+
+
+gol_pool_t* gol_pool_create(uint32_t threads) {
+    if (threads < 1) return NULL;
+
+    gol_pool_t* pool = malloc(sizeof(gol_pool_t));
+    if (pool == NULL) return NULL;
+
+    /* The calling thread is the first thread of the pool, so only the
+     * remaining ones are started. */
+    pool->threads = malloc(sizeof(pthread_t) * threads);
+    if (pool->threads == NULL) {
+        free(pool);
+        return NULL;
+    }
+
+    pool->size = threads;
+    pool->ticket = 0;
+    pool->task = NULL;
+    pool->arg = NULL;
+    pool->stop = false;
+    pool->pending = 0;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    uint32_t i;
+    for (i=0; i + 1 < threads; i++) {
+        gol_pool_worker_t* worker = malloc(sizeof(gol_pool_worker_t));
+        if (worker != NULL) {
+            worker->pool = pool;
+            worker->index = i + 1;
+        }
+        if (worker == NULL ||
+                pthread_create(&pool->threads[i], NULL, _gol_pool_main,
+                               worker) != 0) {
+            free(worker);
+            _gol_pool_shutdown(pool, i);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+void gol_pool_destroy(gol_pool_t* pool) {
+    if (pool) {
+        _gol_pool_shutdown(pool, pool->size - 1);
+    }
+}
+
+uint32_t gol_pool_size(const gol_pool_t* pool) {
+    return pool->size;
+}
+
+void gol_pool_run(gol_pool_t* pool, gol_pool_task_t task, void* arg) {
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->arg = arg;
+    pool->pending = pool->size;
+    pool->ticket++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    task(arg, 0, pool->size);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->pending--;
+    while (pool->pending > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
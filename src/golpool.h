@@ -0,0 +1,56 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: golpool.h
+ * description: Persistent worker thread pool
+ * author: Donkey Coding Group
+ *
+ * This C header defines a pool of worker threads that live as long as the
+ * pool does. A task is run on all threads at once and the call returns when
+ * every thread has passed the pool's barrier, so a generation step costs a
+ * wake-up and a single barrier instead of spawning threads. */
+
+#ifndef NIKLASROSENSTEIN_GAME_OF_LIFE_POOL
+#define NIKLASROSENSTEIN_GAME_OF_LIFE_POOL
+
+#include <stdint.h>
+
+typedef struct _gol_pool gol_pool_t;
+
+/* A task run by the pool. *index* is the number of the thread running it,
+ * counting from zero, and *count* is the total number of threads. */
+typedef void (*gol_pool_task_t)(void* arg, uint32_t index, uint32_t count);
+
+/* Create a pool of *threads* threads, including the calling thread which
+ * takes part in every task as index zero. Returns NULL if the threads could
+ * not be started or *threads* is zero. */
+gol_pool_t* gol_pool_create(uint32_t threads);
+
+/* Stop and join the worker threads and free the pool. */
+void gol_pool_destroy(gol_pool_t* pool);
+
+/* Returns the number of threads of the pool. */
+uint32_t gol_pool_size(const gol_pool_t* pool);
+
+/* Run *task* on every thread of the pool and wait for all of them to
+ * finish. */
+void gol_pool_run(gol_pool_t* pool, gol_pool_task_t task, void* arg);
+
+#endif /* NIKLASROSENSTEIN_GAME_OF_LIFE_POOL */
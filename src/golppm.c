@@ -0,0 +1,63 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: golppm.c
+ * description: Rendering a Game of Life into a PPM Image Buffer
+ * author: Donkey Coding Group */
+
+#include "golppm.h"
+#include "golprof.h"
+
+
+bool gol_to_ppm(const struct gol_to_ppm_params params) {
+    if (params.scale <= 0.0001) {
+        return false;
+    }
+    if (params.game == NULL || params.buffer == NULL) {
+        return false;
+    }
+
+    GOL_PROFILE_BEGIN(start);
+    int i, j, x, y;
+    for (j=0; j < params.buffer->height; j++) {
+        y = params.yoff + ((float) j * params.scale);
+        if (y >= params.game->height) break;
+
+        for (i=0; i < params.buffer->width; i++) {
+            x = params.xoff + ((float) i * params.scale);
+            if (x >= params.game->width) break;
+
+            bool state = game_of_life_cell(params.game, x, y);
+            ppm_pixel_t* pixel = ppm_pixel_buffer_get(params.buffer, i, j);
+
+            if (pixel == NULL) {
+                fprintf(stderr, "gol_to_ppm() at (%u, %u) -> (%u, %u) got "
+                                "pixel:0x%zx\n", i, j, x, y, (size_t) pixel);
+                break;
+            }
+
+            if (state) *pixel = params.calive;
+            else *pixel = params.cdead;
+        }
+    }
+
+    GOL_PROFILE_END(start, GOL_PHASE_PPM);
+    return true;
+}
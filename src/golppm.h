@@ -0,0 +1,65 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: golppm.h
+ * description: Rendering a Game of Life into a PPM Image Buffer
+ * author: Donkey Coding Group
+ *
+ * This C header defines the function that draws the grid of a Game of
+ * Life into a :class:`ppm_pixel_buffer_t`. */
+
+#ifndef NIKLASROSENSTEIN_GAME_OF_LIFE_PPM
+#define NIKLASROSENSTEIN_GAME_OF_LIFE_PPM
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "gol.h"
+#include "ppm.h"
+
+/* Structure that contains parameters for writing a Game of Life into a
+ * PPM Image Buffer. */
+struct gol_to_ppm_params {
+    /* A floating point number representing the scale of the game
+     * mapped on to the image buffer. Note that no anti-aliasing is
+     * performed. */
+    float scale;
+
+    /* X and Y offset of the Game of Life in the PPM Image Buffer. */
+    uint16_t xoff, yoff;
+
+    /* The color of an alive cell. */
+    ppm_pixel_t calive;
+
+    /* The color of a dead cell. */
+    ppm_pixel_t cdead;
+
+    /* The Game of Life to write. */
+    const game_of_life_t* game;
+
+    /* The PPM Image Buffer to fill. */
+    const ppm_pixel_buffer_t* buffer;
+};
+
+/* Fills the PPM Image Buffer with the cells of the game. Returns false if
+ * the scale is too small or the game or buffer is missing. */
+bool gol_to_ppm(const struct gol_to_ppm_params params);
+
+#endif /* NIKLASROSENSTEIN_GAME_OF_LIFE_PPM */
@@ -0,0 +1,118 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: golprof.c
+ * description: Timers and counters of the phases of a Game of Life
+ * author: Donkey Coding Group */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "golprof.h"
+
+
+/* The times of a phase. *samples* is a ring of the last times, written at
+ * the index of *count* when it is taken. Every field is accessed
+ * atomically, so that any thread may record a phase and the summary can
+ * be read while it is being recorded. */
+typedef struct gol_profile_phase {
+    uint64_t count;
+    uint64_t total;
+    uint64_t samples[GOL_PROFILE_SAMPLES];
+} gol_profile_phase_t;
+
+static gol_profile_phase_t gol_profile_phases[GOL_PHASE_COUNT];
+static uint64_t gol_profile_counters[GOL_COUNTER_COUNT];
+
+
+uint64_t gol_profile_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+void gol_profile_record(GOL_PHASE phase, uint64_t ns) {
+    if (phase >= GOL_PHASE_COUNT) return;
+    gol_profile_phase_t* p = &gol_profile_phases[phase];
+    uint64_t count = __atomic_fetch_add(&p->count, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&p->samples[count % GOL_PROFILE_SAMPLES], ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&p->total, ns, __ATOMIC_RELAXED);
+}
+
+void gol_profile_count(GOL_COUNTER counter, uint64_t n) {
+    if (counter >= GOL_COUNTER_COUNT) return;
+    __atomic_fetch_add(&gol_profile_counters[counter], n, __ATOMIC_RELAXED);
+}
+
+uint64_t gol_profile_counter(GOL_COUNTER counter) {
+    if (counter >= GOL_COUNTER_COUNT) return 0;
+    return __atomic_load_n(&gol_profile_counters[counter], __ATOMIC_RELAXED);
+}
+
+/* Compares two times for qsort(). */
+static int _gol_profile_compare(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*) a;
+    uint64_t y = *(const uint64_t*) b;
+    return (x > y) - (x < y);
+}
+
+bool gol_profile_summary(GOL_PHASE phase, gol_profile_summary_t* summary) {
+    uint64_t samples[GOL_PROFILE_SAMPLES];
+    uint64_t sum = 0;
+    uint32_t n, i;
+
+    memset(summary, 0, sizeof(*summary));
+    if (phase >= GOL_PHASE_COUNT) return false;
+    gol_profile_phase_t* p = &gol_profile_phases[phase];
+    summary->count = __atomic_load_n(&p->count, __ATOMIC_RELAXED);
+    summary->total = __atomic_load_n(&p->total, __ATOMIC_RELAXED);
+    if (summary->count == 0) return false;
+
+    n = summary->count < GOL_PROFILE_SAMPLES
+      ? (uint32_t) summary->count : GOL_PROFILE_SAMPLES;
+    for (i=0; i < n; i++) {
+        samples[i] = __atomic_load_n(&p->samples[i], __ATOMIC_RELAXED);
+        sum += samples[i];
+    }
+    qsort(samples, n, sizeof(uint64_t), _gol_profile_compare);
+
+    summary->mean = sum / n;
+    summary->p50 = samples[(n - 1) * 50 / 100];
+    summary->p90 = samples[(n - 1) * 90 / 100];
+    summary->p99 = samples[(n - 1) * 99 / 100];
+    summary->max = samples[n - 1];
+    return true;
+}
+
+void gol_profile_reset(void) {
+    memset(gol_profile_phases, 0, sizeof(gol_profile_phases));
+    memset(gol_profile_counters, 0, sizeof(gol_profile_counters));
+}
+
+const char* gol_profile_phase_name(GOL_PHASE phase) {
+    switch (phase) {
+        case GOL_PHASE_STEP: return "step";
+        case GOL_PHASE_RENDER: return "render";
+        case GOL_PHASE_PPM: return "ppm";
+        case GOL_PHASE_IO: return "io";
+        case GOL_PHASE_COUNT: break;
+    }
+    return "unknown";
+}
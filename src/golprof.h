@@ -0,0 +1,126 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: golprof.h
+ * description: Timers and counters of the phases of a Game of Life
+ * author: Donkey Coding Group
+ *
+ * This C header defines a process-wide record of where the time goes:
+ * the time spent in each phase, such as calculating generations or
+ * printing them, and counters of the work done. The last
+ * GOL_PROFILE_SAMPLES times of every phase are kept for rolling averages
+ * and percentiles. Recording costs two reads of the monotonic clock and a
+ * few stores. Compiling with GOL_NO_PROFILE defined turns the
+ * GOL_PROFILE_* macros into nothing. */
+
+#ifndef NIKLASROSENSTEIN_GAME_OF_LIFE_PROFILE
+#define NIKLASROSENSTEIN_GAME_OF_LIFE_PROFILE
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* The number of times of each phase that are kept. */
+#define GOL_PROFILE_SAMPLES 256
+
+/* The phases that are timed. */
+typedef enum GOL_PHASE {
+    /* Calculating generations. */
+    GOL_PHASE_STEP = 0,
+
+    /* Rendering a generation for the Terminal. */
+    GOL_PHASE_RENDER,
+
+    /* Drawing a generation into a PPM Image Buffer. */
+    GOL_PHASE_PPM,
+
+    /* Writing to the Terminal or to files. */
+    GOL_PHASE_IO,
+
+    GOL_PHASE_COUNT,
+} GOL_PHASE;
+
+/* The counters. */
+typedef enum GOL_COUNTER {
+    /* The generations that were calculated. */
+    GOL_COUNTER_GENERATIONS = 0,
+
+    /* The cells that were calculated, width times height per
+     * generation. */
+    GOL_COUNTER_CELLS,
+
+    /* The bytes written to the Terminal or to files. */
+    GOL_COUNTER_BYTES,
+
+    /* Frames that were published but replaced before they were shown. */
+    GOL_COUNTER_FRAMES_DROPPED,
+
+    GOL_COUNTER_COUNT,
+} GOL_COUNTER;
+
+/* A summary of the times of a phase, in nanoseconds. *count* and *total*
+ * cover every time that was recorded, the others only the last
+ * GOL_PROFILE_SAMPLES. All zero if no time was recorded. */
+typedef struct gol_profile_summary {
+    uint64_t count;
+    uint64_t total;
+    uint64_t mean;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t max;
+} gol_profile_summary_t;
+
+/* Returns the time of the monotonic clock in nanoseconds. */
+uint64_t gol_profile_clock(void);
+
+/* Record that a phase took *ns* nanoseconds. Any thread may record. */
+void gol_profile_record(GOL_PHASE phase, uint64_t ns);
+
+/* Add *n* to a counter. Any thread may count. */
+void gol_profile_count(GOL_COUNTER counter, uint64_t n);
+
+/* Returns the value of a counter. */
+uint64_t gol_profile_counter(GOL_COUNTER counter);
+
+/* Summarize the times of a phase. Returns false if no time was recorded. */
+bool gol_profile_summary(GOL_PHASE phase, gol_profile_summary_t* summary);
+
+/* Forget all times and counts. Must not be called while phases are being
+ * recorded. */
+void gol_profile_reset(void);
+
+/* Returns a short name of a phase, such as "step". */
+const char* gol_profile_phase_name(GOL_PHASE phase);
+
+/* Time the code between GOL_PROFILE_BEGIN(name) and
+ * GOL_PROFILE_END(name, phase) in the same block, and count work with
+ * GOL_PROFILE_COUNT. */
+#ifndef GOL_NO_PROFILE
+#define GOL_PROFILE_BEGIN(name) uint64_t name = gol_profile_clock()
+#define GOL_PROFILE_END(name, phase) \
+    gol_profile_record((phase), gol_profile_clock() - (name))
+#define GOL_PROFILE_COUNT(counter, n) gol_profile_count((counter), (n))
+#else
+#define GOL_PROFILE_BEGIN(name) ((void) 0)
+#define GOL_PROFILE_END(name, phase) ((void) 0)
+#define GOL_PROFILE_COUNT(counter, n) ((void) 0)
+#endif
+
+#endif /* NIKLASROSENSTEIN_GAME_OF_LIFE_PROFILE */
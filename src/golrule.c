@@ -0,0 +1,211 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: golrule.c
+ * description: Birth/survival rules of Life-like cellular automata
+ * author: Donkey Coding Group */
+
+#include <stddef.h>
+#include <stdio.h>
+#include "golrule.h"
+
+
+/* Parses a run of neighbour counts into *mask* and returns the character
+ * after it. */
+static const char* _gol_rule_counts(const char* s, uint16_t* mask) {
+    *mask = 0;
+    while (*s >= '0' && *s <= '8') {
+        *mask |= 1 << (*s - '0');
+        s++;
+    }
+    return s;
+}
+
+gol_rule_t gol_rule_conway(void) {
+    gol_rule_t rule;
+    rule.birth = 1 << 3;
+    rule.survival = (1 << 2) | (1 << 3);
+    return rule;
+}
+
+bool gol_rule_parse(const char* string, gol_rule_t* rule) {
+    if (string == NULL || rule == NULL) return false;
+
+    const char* s = string;
+    uint16_t birth = 0;
+    uint16_t survival = 0;
+
+    if ((*s >= '0' && *s <= '9') || *s == '/') {
+        /* The older notation, survival counts first. */
+        s = _gol_rule_counts(s, &survival);
+        if (*s++ != '/') return false;
+        s = _gol_rule_counts(s, &birth);
+        if (*s != '\0') return false;
+    }
+    else {
+        bool seen_birth = false;
+        bool seen_survival = false;
+        while (*s != '\0') {
+            if ((*s == 'B' || *s == 'b') && !seen_birth) {
+                s = _gol_rule_counts(s + 1, &birth);
+                seen_birth = true;
+            }
+            else if ((*s == 'S' || *s == 's') && !seen_survival) {
+                s = _gol_rule_counts(s + 1, &survival);
+                seen_survival = true;
+            }
+            else {
+                return false;
+            }
+
+            /* The sections may be separated by a single slash. */
+            if (*s == '/' && seen_birth != seen_survival) s++;
+        }
+        if (!seen_birth || !seen_survival) return false;
+    }
+
+    rule->birth = birth;
+    rule->survival = survival;
+    return true;
+}
+
+char* gol_rule_format(gol_rule_t rule, char* buffer) {
+    char* p = buffer;
+    int k;
+    *p++ = 'B';
+    for (k=0; k <= 8; k++) {
+        if (rule.birth & (1 << k)) *p++ = '0' + k;
+    }
+    *p++ = '/';
+    *p++ = 'S';
+    for (k=0; k <= 8; k++) {
+        if (rule.survival & (1 << k)) *p++ = '0' + k;
+    }
+    *p = '\0';
+    return buffer;
+}
+
+void gol_rule_compile(gol_rule_t rule, gol_rule_compiled_t* compiled) {
+    uint64_t base[9], flip[9];
+    int k;
+    for (k=0; k <= 8; k++) {
+        uint64_t birth = (rule.birth >> k) & 1;
+        uint64_t survival = (rule.survival >> k) & 1;
+        base[k] = -birth;
+        flip[k] = -(birth ^ survival);
+    }
+    for (k=0; k < 8; k += 2) {
+        compiled->base[k] = base[k];
+        compiled->flip[k] = flip[k];
+        compiled->base[k + 1] = base[k] ^ base[k + 1];
+        compiled->flip[k + 1] = flip[k] ^ flip[k + 1];
+    }
+    compiled->base[8] = base[0] ^ base[8];
+    compiled->flip[8] = flip[0] ^ flip[8];
+}
+
+bool gol_rule_births_from_nothing(gol_rule_t rule) {
+    return (rule.birth & 1) != 0;
+}
+
+/* Parses a decimal number of at most four digits into *value* and returns
+ * the character after it, or NULL if there is no number. */
+static const char* _gol_ltl_number(const char* s, uint32_t* value) {
+    int digits = 0;
+    *value = 0;
+    while (*s >= '0' && *s <= '9' && digits < 4) {
+        *value = *value * 10 + (*s - '0');
+        s++;
+        digits++;
+    }
+    return (digits == 0 || (*s >= '0' && *s <= '9')) ? NULL : s;
+}
+
+/* Parses a range of counts, "min..max", and returns the character after
+ * it, or NULL if it is invalid. */
+static const char* _gol_ltl_interval(
+        const char* s, uint32_t* min, uint32_t* max) {
+    s = _gol_ltl_number(s, min);
+    if (s == NULL || s[0] != '.' || s[1] != '.') return NULL;
+    s = _gol_ltl_number(s + 2, max);
+    return (s && *min <= *max) ? s : NULL;
+}
+
+bool gol_ltl_rule_parse(const char* string, gol_ltl_rule_t* rule) {
+    if (string == NULL || rule == NULL) return false;
+
+    const char* s = string;
+    gol_ltl_rule_t parsed = {0, false, 0, 0, 0, 0};
+    bool seen_birth = false;
+    bool seen_survival = false;
+    uint32_t value;
+
+    while (s && *s != '\0') {
+        char key = *s++;
+        if (key >= 'a' && key <= 'z') key -= 'a' - 'A';
+        switch (key) {
+            case 'R':
+                s = _gol_ltl_number(s, &parsed.range);
+                break;
+            case 'C':
+                s = _gol_ltl_number(s, &value);
+                if (s && value != 0 && value != 2) return false;
+                break;
+            case 'M':
+                s = _gol_ltl_number(s, &value);
+                if (s && value > 1) return false;
+                parsed.middle = value;
+                break;
+            case 'S':
+                s = _gol_ltl_interval(s, &parsed.survival_min, &parsed.survival_max);
+                seen_survival = true;
+                break;
+            case 'B':
+                s = _gol_ltl_interval(s, &parsed.birth_min, &parsed.birth_max);
+                seen_birth = true;
+                break;
+            case 'N':
+                if (*s != 'M' && *s != 'm') return false;
+                s++;
+                break;
+            default:
+                return false;
+        }
+        if (s && *s == ',') s++;
+    }
+
+    if (s == NULL || !seen_birth || !seen_survival) return false;
+    if (parsed.range < 1 || parsed.range > GOL_LTL_MAX_RANGE) return false;
+    *rule = parsed;
+    return true;
+}
+
+char* gol_ltl_rule_format(gol_ltl_rule_t rule, char* buffer) {
+    snprintf(buffer, GOL_LTL_RULE_STRING_SIZE, "R%u,C0,M%d,S%u..%u,B%u..%u,NM",
+             rule.range, rule.middle ? 1 : 0, rule.survival_min,
+             rule.survival_max, rule.birth_min, rule.birth_max);
+    return buffer;
+}
+
+bool gol_ltl_rule_equal(gol_ltl_rule_t a, gol_ltl_rule_t b) {
+    return a.range == b.range && a.middle == b.middle &&
+           a.birth_min == b.birth_min && a.birth_max == b.birth_max &&
+           a.survival_min == b.survival_min && a.survival_max == b.survival_max;
+}
@@ -0,0 +1,119 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: golrule.h
+ * description: Birth/survival rules of Life-like cellular automata
+ * author: Donkey Coding Group
+ *
+ * This C header defines the rules of the Game of Life and its relatives as
+ * sets of neighbour counts, and their conversion from and to the usual
+ * "B3/S23" notation, as well as the Larger than Life rules, which count
+ * the neighbours in a square of a larger range. */
+
+#ifndef NIKLASROSENSTEIN_GAME_OF_LIFE_RULE
+#define NIKLASROSENSTEIN_GAME_OF_LIFE_RULE
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* The size of the buffer that :func:`gol_rule_format` writes to, enough for
+ * "B012345678/S012345678" and the terminating null character. */
+#define GOL_RULE_STRING_SIZE 22
+
+/* A rule of a Life-like cellular automaton. Bit k of *birth* is set if a
+ * dead cell with k living neighbours comes alive, bit k of *survival* if a
+ * living cell with k living neighbours stays alive. Only the bits 0 to 8
+ * are used. */
+typedef struct gol_rule {
+    uint16_t birth;
+    uint16_t survival;
+} gol_rule_t;
+
+/* A rule compiled for the bitsliced evaluation of the kernels. Each entry
+ * is a function of the state of a cell, base[i] ^ (cell & flip[i]), where
+ * every word is either all zeros or all ones. The even entries below eight
+ * give the next state of a cell with that many neighbours, the odd entries
+ * the difference to the entry before them, and entry eight the difference
+ * between eight and no neighbours. */
+typedef struct gol_rule_compiled {
+    uint64_t base[9];
+    uint64_t flip[9];
+} gol_rule_compiled_t;
+
+/* The largest range of a Larger than Life rule. The neighbourhood of a
+ * cell must not reach beyond the tiles next to its own. */
+#define GOL_LTL_MAX_RANGE 32
+
+/* The size of the buffer that :func:`gol_ltl_rule_format` writes to. */
+#define GOL_LTL_RULE_STRING_SIZE 64
+
+/* A Larger than Life rule with two states and the square (Moore)
+ * neighbourhood of *range* cells in every direction. A dead cell with
+ * *birth_min* to *birth_max* living neighbours comes alive, a living cell
+ * with *survival_min* to *survival_max* stays alive. The cell itself is
+ * one of its neighbours if *middle* is true. A range of zero means that
+ * the rule is not used. */
+typedef struct gol_ltl_rule {
+    uint32_t range;
+    bool middle;
+    uint32_t birth_min;
+    uint32_t birth_max;
+    uint32_t survival_min;
+    uint32_t survival_max;
+} gol_ltl_rule_t;
+
+/* Returns Conway's rule, B3/S23. */
+gol_rule_t gol_rule_conway(void);
+
+/* Parse a rule string into *rule*. Accepted are the "B3/S23" notation, in
+ * either order, with any case and with or without the slash, as well as
+ * the older "23/3" notation which lists the survival counts first. Returns
+ * false and leaves *rule* untouched if the string is not a valid rule. */
+bool gol_rule_parse(const char* string, gol_rule_t* rule);
+
+/* Write the rule in "B3/S23" notation into *buffer*, which must hold at
+ * least GOL_RULE_STRING_SIZE characters. Returns *buffer*. */
+char* gol_rule_format(gol_rule_t rule, char* buffer);
+
+/* Compile *rule* into *compiled*. */
+void gol_rule_compile(gol_rule_t rule, gol_rule_compiled_t* compiled);
+
+/* Returns true if the rule gives birth to cells without any neighbours.
+ * Such rules fill the empty space around a pattern in every other
+ * generation, which the unbounded engines can't represent. */
+bool gol_rule_births_from_nothing(gol_rule_t rule);
+
+/* Parse a Larger than Life rule in the notation of Golly, such as
+ * "R5,C0,M1,S34..58,B34..45,NM", in any case. The range (R), survival (S)
+ * and birth (B) are required; the number of states (C) must be 0 or 2, the
+ * middle (M) defaults to 0 and the neighbourhood (N) must be M. Returns
+ * false and leaves *rule* untouched if the string is not such a rule or its
+ * range is larger than GOL_LTL_MAX_RANGE. */
+bool gol_ltl_rule_parse(const char* string, gol_ltl_rule_t* rule);
+
+/* Write the rule in the notation of :func:`gol_ltl_rule_parse` into
+ * *buffer*, which must hold at least GOL_LTL_RULE_STRING_SIZE characters.
+ * Returns *buffer*. */
+char* gol_ltl_rule_format(gol_ltl_rule_t rule, char* buffer);
+
+/* Returns true if both are the same rule. */
+bool gol_ltl_rule_equal(gol_ltl_rule_t a, gol_ltl_rule_t b);
+
+#endif /* NIKLASROSENSTEIN_GAME_OF_LIFE_RULE */
@@ -0,0 +1,406 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: golstream.c
+ * description: Game of Life boards kept in a file and stepped in bands
+ * author: Donkey Coding Group */
+
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "golstream.h"
+#include "golkernel.h"
+#include "golprof.h"
+
+#define GOL_STREAM_MAGIC "SOLSTRM"
+#define GOL_STREAM_VERSION 1
+
+/* Written as a native integer, to detect a file of a machine with a
+ * different byte order. */
+#define GOL_STREAM_BYTE_ORDER 0x01020304
+
+/* The rows start after a page, so that the reads of whole pages are
+ * aligned in the file. */
+#define GOL_STREAM_HEADER_SIZE 4096
+
+/* The number of rows read or written with a single system call. */
+#define GOL_STREAM_IOV 1024
+
+/* The header at the start of the file. */
+typedef struct gol_stream_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t width;
+    uint32_t height;
+    uint64_t generation;
+    uint64_t population;
+    uint32_t adjacency;
+    uint16_t birth;
+    uint16_t survival;
+
+    /* The generation that a pass was calculating when the header was
+     * written, or zero. Files of earlier builds have a zero here. */
+    uint64_t pass;
+} gol_stream_header_t;
+
+
+/* Returns the offset of row *y* in the file. */
+static off_t _gol_stream_offset(const gol_stream_t* stream, uint32_t y) {
+    return GOL_STREAM_HEADER_SIZE +
+           (off_t) y * stream->context->stride * sizeof(uint64_t);
+}
+
+/* Reads or writes the rows [y, y + count) of the file from or to the rows
+ * of a grid that are *pitch* words apart, a few thousand rows per system
+ * call. Returns false if the file could not be read or written. */
+static bool _gol_stream_rows(
+        const gol_stream_t* stream, uint64_t* rows, size_t pitch, uint32_t y,
+        uint32_t count, bool write) {
+    size_t row_bytes = sizeof(uint64_t) * stream->context->stride;
+    struct iovec iov[GOL_STREAM_IOV];
+    GOL_PROFILE_BEGIN(start);
+
+    while (count > 0) {
+        uint32_t n = count < GOL_STREAM_IOV ? count : GOL_STREAM_IOV;
+        uint32_t i;
+        for (i=0; i < n; i++) {
+            iov[i].iov_base = rows + (size_t) i * pitch;
+            iov[i].iov_len = row_bytes;
+        }
+
+        /* Short transfers continue where they stopped. */
+        off_t offset = _gol_stream_offset(stream, y);
+        struct iovec* next = iov;
+        int left = n;
+        while (left > 0) {
+            ssize_t done = write ? pwritev(stream->fd, next, left, offset)
+                                 : preadv(stream->fd, next, left, offset);
+            if (done < 0 && errno == EINTR) continue;
+            if (done <= 0) return false;
+            offset += done;
+            while (left > 0 && (size_t) done >= next->iov_len) {
+                done -= next->iov_len;
+                next++;
+                left--;
+            }
+            if (left > 0) {
+                next->iov_base = (char*) next->iov_base + done;
+                next->iov_len -= done;
+            }
+        }
+
+        if (write) GOL_PROFILE_COUNT(GOL_COUNTER_BYTES, row_bytes * n);
+        rows += (size_t) n * pitch;
+        y += n;
+        count -= n;
+    }
+    GOL_PROFILE_END(start, GOL_PHASE_IO);
+    return true;
+}
+
+/* Writes the header of the board. */
+static bool _gol_stream_write_header(const gol_stream_t* stream) {
+    gol_stream_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, GOL_STREAM_MAGIC, sizeof(GOL_STREAM_MAGIC));
+    header.version = GOL_STREAM_VERSION;
+    header.byte_order = GOL_STREAM_BYTE_ORDER;
+    header.width = stream->width;
+    header.height = stream->height;
+    header.generation = stream->generation;
+    header.population = stream->population;
+    header.adjacency = stream->context->adjacency;
+    header.birth = stream->context->rule.birth;
+    header.survival = stream->context->rule.survival;
+    header.pass = stream->pass;
+    return pwrite(stream->fd, &header, sizeof(header), 0) == sizeof(header);
+}
+
+/* Writes the header and waits until it and the rows written before are
+ * stored on the disk. */
+static bool _gol_stream_sync_header(const gol_stream_t* stream) {
+    return _gol_stream_write_header(stream) && fdatasync(stream->fd) == 0;
+}
+
+/* Frees the board without writing its header. */
+static void _gol_stream_free(gol_stream_t* stream) {
+    if (stream->fd >= 0) close(stream->fd);
+    if (stream->band) free(stream->band - stream->context->pitch - 1);
+    free(stream->out);
+    free(stream->first);
+    game_of_life_destroy(stream->context);
+    free(stream);
+}
+
+/* Allocates a board of the specified size for the open file *fd*, with a
+ * band of as many rows as fit into *memory* bytes. */
+static gol_stream_t* _gol_stream_alloc(
+        int fd, uint32_t width, uint32_t height, bool adjacency,
+        size_t memory) {
+    gol_stream_t* stream = calloc(1, sizeof(gol_stream_t));
+    if (stream == NULL) {
+        close(fd);
+        return NULL;
+    }
+    stream->fd = fd;
+    stream->width = width;
+    stream->height = height;
+    stream->context = game_of_life_create(width, 1, adjacency);
+    if (stream->context == NULL) {
+        _gol_stream_free(stream);
+        return NULL;
+    }
+
+    /* A row of the band and a row of its next generation. */
+    uint32_t pitch = stream->context->pitch;
+    uint32_t stride = stream->context->stride;
+    if (memory == 0) memory = GOL_STREAM_DEFAULT_MEMORY;
+    size_t rows = memory / (sizeof(uint64_t) * (pitch + stride));
+    if (rows < 1) rows = 1;
+    if (rows > height) rows = height;
+    stream->rows = rows;
+
+    uint64_t* band = malloc(sizeof(uint64_t) * pitch * (rows + 2));
+    stream->band = band ? band + pitch + 1 : NULL;
+    stream->out = malloc(sizeof(uint64_t) * stride * rows);
+    stream->first = malloc(sizeof(uint64_t) * pitch);
+    if (stream->band == NULL || stream->out == NULL || stream->first == NULL) {
+        _gol_stream_free(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+gol_stream_t* gol_stream_create(
+        const char* filename, uint32_t width, uint32_t height, bool adjacency,
+        size_t memory) {
+    if (width < 1 || height < 1) return NULL;
+    int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return NULL;
+
+    gol_stream_t* stream = _gol_stream_alloc(fd, width, height, adjacency, memory);
+    if (stream == NULL) return NULL;
+    if (ftruncate(fd, _gol_stream_offset(stream, height)) != 0 ||
+            !_gol_stream_write_header(stream)) {
+        _gol_stream_free(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+gol_stream_t* gol_stream_open(const char* filename, size_t memory) {
+    gol_stream_header_t header;
+    int fd = open(filename, O_RDWR);
+    if (fd < 0) return NULL;
+    if (pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+            memcmp(header.magic, GOL_STREAM_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != GOL_STREAM_VERSION ||
+            header.byte_order != GOL_STREAM_BYTE_ORDER ||
+            header.width < 1 || header.height < 1 ||
+            header.birth > 0x1ff || header.survival > 0x1ff ||
+            header.pass != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    gol_stream_t* stream = _gol_stream_alloc(
+            fd, header.width, header.height, header.adjacency, memory);
+    if (stream == NULL) return NULL;
+    stream->generation = header.generation;
+    stream->population = header.population;
+    stream->context->rule.birth = header.birth;
+    stream->context->rule.survival = header.survival;
+    return stream;
+}
+
+bool gol_stream_close(gol_stream_t* stream) {
+    if (stream == NULL) return true;
+    bool success = _gol_stream_write_header(stream);
+    _gol_stream_free(stream);
+    return success;
+}
+
+bool gol_stream_set_rule(gol_stream_t* stream, const char* rule) {
+    return gol_rule_parse(rule, &stream->context->rule);
+}
+
+bool gol_stream_import(
+        gol_stream_t* stream, const game_of_life_t* game, uint32_t y) {
+    if (game->width != stream->width || y > stream->height ||
+            game->height > stream->height - y) {
+        return false;
+    }
+    return _gol_stream_rows(stream, game_of_life_row(game, 0), game->pitch,
+                            y, game->height, true);
+}
+
+bool gol_stream_export(
+        const gol_stream_t* stream, game_of_life_t* game, uint32_t y) {
+    if (game->width != stream->width || y > stream->height ||
+            game->height > stream->height - y) {
+        return false;
+    }
+    if (!_gol_stream_rows(stream, game_of_life_row(game, 0), game->pitch,
+                          y, game->height, false)) {
+        return false;
+    }
+    game->generation = stream->generation;
+    game->rule = stream->context->rule;
+    memset(&game->ltl, 0, sizeof(game->ltl));
+    game_of_life_wake(game);
+    return true;
+}
+
+/* Advises the system about the rows [y, y + count) of the file. */
+static void _gol_stream_advise(
+        const gol_stream_t* stream, uint32_t y, uint32_t count, int advice) {
+    off_t offset = _gol_stream_offset(stream, y);
+    posix_fadvise(stream->fd, offset, _gol_stream_offset(stream, y + count) - offset,
+                  advice);
+}
+
+/* Calculates the next generation of the whole board in a single pass. The
+ * band holds the rows [y, y + n) of the current generation, with the row
+ * above in its upper halo row and the row below in its lower one. Rows
+ * above the band were already overwritten in the file, so the last row of
+ * a band is kept as the upper halo row of the next one, and the first row
+ * of the board is kept for the lower halo row of the last band. */
+static bool _gol_stream_step(gol_stream_t* stream) {
+    const game_of_life_t* context = stream->context;
+    uint32_t pitch = context->pitch;
+    uint32_t stride = context->stride;
+    uint32_t height = stream->height;
+    uint64_t tail_mask = gol_kernel_tail_mask(stream->width);
+    uint64_t* band = stream->band;
+    uint64_t population = 0;
+    uint32_t y, i, w;
+#ifndef GOL_NO_PROFILE
+    uint64_t step_time = 0;
+#endif
+
+    if (context->adjacency) {
+        if (!_gol_stream_rows(stream, band - pitch, pitch, height - 1, 1, false) ||
+                !_gol_stream_rows(stream, stream->first, pitch, 0, 1, false)) {
+            return false;
+        }
+    }
+    else {
+        memset(band - pitch - 1, 0, sizeof(uint64_t) * pitch);
+    }
+
+    for (y=0; y < height; y += stream->rows) {
+        uint32_t n = height - y < stream->rows ? height - y : stream->rows;
+        uint64_t* below = band + (size_t) n * pitch;
+
+        /* The row below the band is read along with it, unless it is the
+         * first row of the board. */
+        if (y + n < height) {
+            if (!_gol_stream_rows(stream, band, pitch, y, n + 1, false)) return false;
+        }
+        else {
+            if (!_gol_stream_rows(stream, band, pitch, y, n, false)) return false;
+            if (context->adjacency) {
+                memcpy(below, stream->first, sizeof(uint64_t) * stride);
+            }
+            else {
+                memset(below, 0, sizeof(uint64_t) * stride);
+            }
+        }
+
+        /* The system reads the next band while this one is calculated. */
+        if (y + n < height) {
+            uint32_t next = height - y - n < stream->rows ? height - y - n : stream->rows;
+            _gol_stream_advise(stream, y + n, next, POSIX_FADV_WILLNEED);
+        }
+
+        GOL_PROFILE_BEGIN(start);
+        for (i=0; i <= n + 1; i++) {
+            gol_kernel_fill_row_halo(context, band + ((int64_t) i - 1) * pitch);
+        }
+        for (i=0; i < n; i++) {
+            const uint64_t* row = band + (size_t) i * pitch;
+            uint64_t* out = stream->out + (size_t) i * stride;
+            context->row_kernel(context, out, row - pitch, row, row + pitch,
+                                0, stride);
+            out[stride - 1] &= tail_mask;
+            for (w=0; w < stride; w++) population += gol_kernel_popcount(out[w]);
+        }
+#ifndef GOL_NO_PROFILE
+        step_time += gol_profile_clock() - start;
+#endif
+
+        if (!_gol_stream_rows(stream, stream->out, stride, y, n, true)) return false;
+
+        /* The written rows are handed to the system to write back right
+         * away, so that the page cache doesn't fill up with them. */
+#ifdef SYNC_FILE_RANGE_WRITE
+        sync_file_range(stream->fd, _gol_stream_offset(stream, y),
+                        _gol_stream_offset(stream, y + n) - _gol_stream_offset(stream, y),
+                        SYNC_FILE_RANGE_WRITE);
+#endif
+
+        /* The last row of the band, as it was, lies above the next band. */
+        memcpy(band - pitch, band + ((size_t) n - 1) * pitch,
+               sizeof(uint64_t) * stride);
+    }
+
+    stream->generation++;
+    stream->population = population;
+
+    /* The time of the bands is recorded as a whole, like the steps of a
+     * game, without the time spent reading and writing. */
+#ifndef GOL_NO_PROFILE
+    gol_profile_record(GOL_PHASE_STEP, step_time);
+#endif
+    GOL_PROFILE_COUNT(GOL_COUNTER_GENERATIONS, 1);
+    GOL_PROFILE_COUNT(GOL_COUNTER_CELLS, (uint64_t) stream->width * height);
+    return true;
+}
+
+bool gol_stream_advance(gol_stream_t* stream, uint64_t n) {
+    game_of_life_t* context = stream->context;
+    if (stream->pass) return false;
+    gol_rule_compile(context->rule, &context->compiled_rule);
+    posix_fadvise(stream->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    /* A pass overwrites the rows in place, so the header marks it as in
+     * progress on the disk before the first row is written, and the mark
+     * is only cleared once all rows are stored. A board whose pass was
+     * interrupted holds rows of two generations and is refused when it is
+     * opened. */
+    while (n-- > 0) {
+        stream->pass = stream->generation + 1;
+        if (!_gol_stream_sync_header(stream) || !_gol_stream_step(stream)) {
+            return false;
+        }
+        if (fdatasync(stream->fd) != 0) return false;
+        stream->pass = 0;
+        if (!_gol_stream_write_header(stream)) return false;
+    }
+    return true;
+}
@@ -0,0 +1,128 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: golstream.h
+ * description: Game of Life boards kept in a file and stepped in bands
+ * author: Donkey Coding Group
+ *
+ * This C header defines boards that live in a file instead of memory, so
+ * that they may be larger than it. A generation is calculated in a single
+ * pass over the file: a band of rows is read, its next generation is
+ * calculated with the rows bordering it and written back in place, and
+ * the next band follows. Only a band and a few rows are in memory at any
+ * time, and the file is read and written front to back, which the system
+ * can read ahead of and write behind. */
+
+#ifndef NIKLASROSENSTEIN_GAME_OF_LIFE_STREAM
+#define NIKLASROSENSTEIN_GAME_OF_LIFE_STREAM
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "gol.h"
+
+/* The memory used for the band of rows if none is specified. */
+#define GOL_STREAM_DEFAULT_MEMORY ((size_t) 64 << 20)
+
+/* This structure represents a board kept in a file. */
+typedef struct _gol_stream {
+    /* The width and height of the board. */
+    uint32_t width;
+    uint32_t height;
+
+    /* The number of generations that have been passed since the creation
+     * of the board, and the number of living cells after the last one that
+     * was calculated, zero before the first. */
+    uint64_t generation;
+    uint64_t population;
+
+    /* The generation that a pass of :func:`gol_stream_advance` is
+     * calculating, or zero. A pass that failed leaves it set, and it is
+     * kept in the header of the file. */
+    uint64_t pass;
+
+    /* The file descriptor of the file. The file starts with a header of a
+     * page, followed by the rows of the board, *stride* words each without
+     * halo words, in the byte order of the machine. */
+    int fd;
+
+    /* A game of a single row that carries the rule, the adjacency and the
+     * kernel. */
+    game_of_life_t* context;
+
+    /* The number of rows of a band, and the band in the layout of
+     * :attr:`game_of_life_t.cells` with a halo row above and below. */
+    uint32_t rows;
+    uint64_t* band;
+
+    /* The next generation of the band, *stride* words per row as they are
+     * written to the file. */
+    uint64_t* out;
+
+    /* The first row of the board, which the last row neighbours if
+     * adjacency is enabled, as it was before the pass overwrote it. */
+    uint64_t* first;
+} gol_stream_t;
+
+/* Create a board of the specified size in the file *filename*, which is
+ * replaced if it exists. All cells are dead, and the rule is Conway's.
+ * The file is created sparse, so dead rows take no space until they are
+ * written. *memory* is the number of bytes to use for a band of rows, or
+ * zero for GOL_STREAM_DEFAULT_MEMORY; a band holds at least a row. Returns
+ * NULL if the file could not be created or memory allocation failed. */
+gol_stream_t* gol_stream_create(
+        const char* filename, uint32_t width, uint32_t height, bool adjacency,
+        size_t memory);
+
+/* Open a board that was created with :func:`gol_stream_create`, using
+ * *memory* bytes for a band like that function. Returns NULL if the file
+ * could not be opened, is not a board of this version, or holds a pass
+ * that did not complete. */
+gol_stream_t* gol_stream_open(const char* filename, size_t memory);
+
+/* Write the header and close the board. Returns false if the header could
+ * not be written. */
+bool gol_stream_close(gol_stream_t* stream);
+
+/* Set the rule from a rule string, see :func:`gol_rule_parse`. Returns
+ * false and leaves the rule unchanged if the string is not a valid rule. */
+bool gol_stream_set_rule(gol_stream_t* stream, const char* rule);
+
+/* Write the rows of a game into the board, starting at row *y*. The game
+ * must have the width of the board and fit into it. Returns false if it
+ * does not or writing failed. */
+bool gol_stream_import(
+        gol_stream_t* stream, const game_of_life_t* game, uint32_t y);
+
+/* Read the rows of the board from row *y* on into a game of the width of
+ * the board, along with the rule and the generation. A Larger than Life
+ * rule of the game is replaced. Returns false if the game does not fit or
+ * reading failed, in which case the grid of the game is undefined. */
+bool gol_stream_export(
+        const gol_stream_t* stream, game_of_life_t* game, uint32_t y);
+
+/* Bring the board *n* generations forward, a pass over the file each.
+ * The header is brought up to date on the disk after every pass. Returns
+ * false if reading or writing failed, which leaves the board with some
+ * rows of the next generation; the board can then not be advanced or
+ * opened again. */
+bool gol_stream_advance(gol_stream_t* stream, uint64_t n);
+
+#endif /* NIKLASROSENSTEIN_GAME_OF_LIFE_STREAM */
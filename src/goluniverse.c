@@ -0,0 +1,417 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: goluniverse.c
+ * description: Unbounded sparse Game of Life universe
+ * author: Donkey Coding Group */
+
+#include <stdlib.h>
+#include <string.h>
+#include "goluniverse.h"
+#include "golkernel.h"
+
+
+/* A chunk of 64x64 cells. Bit ``x`` of row ``y`` is the cell at
+ * ``(cx * 64 + x, cy * 64 + y)``. The rows of the current generation are
+ * ``rows[generation & 1]``, the others receive the next generation. */
+struct _gol_chunk {
+    int64_t cx;
+    int64_t cy;
+    size_t index;
+    uint64_t rows[2][GOL_CHUNK_SIZE];
+};
+
+
+/* Returns the coordinate of the chunk that contains the cell coordinate
+ * *v*, rounding towards negative infinity. */
+static int64_t _gol_chunk_coord(int64_t v) {
+    if (v >= 0) return v / GOL_CHUNK_SIZE;
+    return -((-(v + 1)) / GOL_CHUNK_SIZE) - 1;
+}
+
+static size_t _gol_chunk_hash(int64_t cx, int64_t cy) {
+    uint64_t h = (uint64_t) cx * 0x9e3779b97f4a7c15ull;
+    h ^= ((uint64_t) cy + 0x632be59bd9b4e019ull) * 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 31;
+    return (size_t) h;
+}
+
+static gol_chunk_t* _gol_chunk_get(
+        const gol_universe_t* universe, int64_t cx, int64_t cy) {
+    size_t i = _gol_chunk_hash(cx, cy) & universe->table_mask;
+    while (universe->table[i]) {
+        gol_chunk_t* chunk = universe->table[i];
+        if (chunk->cx == cx && chunk->cy == cy) return chunk;
+        i = (i + 1) & universe->table_mask;
+    }
+    return NULL;
+}
+
+static void _gol_chunk_insert(gol_universe_t* universe, gol_chunk_t* chunk) {
+    size_t i = _gol_chunk_hash(chunk->cx, chunk->cy) & universe->table_mask;
+    while (universe->table[i]) {
+        i = (i + 1) & universe->table_mask;
+    }
+    universe->table[i] = chunk;
+}
+
+/* Returns the chunk at the specified chunk coordinate, allocating an empty
+ * one if it doesn't exist. Returns NULL if memory allocation failed. */
+static gol_chunk_t* _gol_chunk_add(
+        gol_universe_t* universe, int64_t cx, int64_t cy) {
+    gol_chunk_t* chunk = _gol_chunk_get(universe, cx, cy);
+    if (chunk) return chunk;
+
+    /* Keep the hash table at most half full. */
+    if ((universe->chunk_count + 1) * 2 > universe->table_mask + 1) {
+        size_t size = (universe->table_mask + 1) * 2;
+        gol_chunk_t** table = calloc(size, sizeof(gol_chunk_t*));
+        if (table == NULL) return NULL;
+        free(universe->table);
+        universe->table = table;
+        universe->table_mask = size - 1;
+
+        size_t i;
+        for (i=0; i < universe->chunk_count; i++) {
+            _gol_chunk_insert(universe, universe->chunks[i]);
+        }
+    }
+
+    if (universe->chunk_count == universe->chunk_capacity) {
+        size_t capacity = universe->chunk_capacity * 2;
+        gol_chunk_t** chunks = realloc(universe->chunks,
+                                       sizeof(gol_chunk_t*) * capacity);
+        if (chunks == NULL) return NULL;
+        universe->chunks = chunks;
+        universe->chunk_capacity = capacity;
+    }
+
+    chunk = calloc(1, sizeof(gol_chunk_t));
+    if (chunk == NULL) return NULL;
+    chunk->cx = cx;
+    chunk->cy = cy;
+    chunk->index = universe->chunk_count;
+    universe->chunks[universe->chunk_count++] = chunk;
+    _gol_chunk_insert(universe, chunk);
+    return chunk;
+}
+
+/* Remove a chunk from the universe and free it. */
+static void _gol_chunk_remove(gol_universe_t* universe, gol_chunk_t* chunk) {
+    size_t mask = universe->table_mask;
+    size_t i = _gol_chunk_hash(chunk->cx, chunk->cy) & mask;
+    while (universe->table[i] != chunk) {
+        i = (i + 1) & mask;
+    }
+
+    /* Shift the following entries of the probe sequence back into the
+     * hole, unless their home slot lies after it. */
+    universe->table[i] = NULL;
+    size_t j = i;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (universe->table[j] == NULL) break;
+        size_t k = _gol_chunk_hash(universe->table[j]->cx,
+                                   universe->table[j]->cy) & mask;
+        bool stays = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+        if (!stays) {
+            universe->table[i] = universe->table[j];
+            universe->table[j] = NULL;
+            i = j;
+        }
+    }
+
+    gol_chunk_t* last = universe->chunks[--universe->chunk_count];
+    universe->chunks[chunk->index] = last;
+    last->index = chunk->index;
+    free(chunk);
+}
+
+/* Returns true if any cell of the rows is alive. */
+static bool _gol_rows_alive(const uint64_t* rows) {
+    uint64_t any = 0;
+    int y;
+    for (y=0; y < GOL_CHUNK_SIZE; y++) any |= rows[y];
+    return any != 0;
+}
+
+/* Makes sure that the chunks the living cells at the edges of a chunk can
+ * grow into exist. Returns false if memory allocation failed. */
+static bool _gol_chunk_grow(
+        gol_universe_t* universe, const gol_chunk_t* chunk, int parity) {
+    const uint64_t* rows = chunk->rows[parity];
+    uint64_t top = rows[0];
+    uint64_t bottom = rows[GOL_CHUNK_SIZE - 1];
+    uint64_t columns = 0;
+    int y;
+    for (y=0; y < GOL_CHUNK_SIZE; y++) columns |= rows[y];
+
+    bool west = columns & 1;
+    bool east = columns >> 63;
+    int64_t cx = chunk->cx;
+    int64_t cy = chunk->cy;
+
+    /* The chunk may move in the chunk array when chunks are added, so
+     * only its coordinates are used from here on. */
+    if (top && !_gol_chunk_add(universe, cx, cy - 1)) return false;
+    if (bottom && !_gol_chunk_add(universe, cx, cy + 1)) return false;
+    if (west && !_gol_chunk_add(universe, cx - 1, cy)) return false;
+    if (east && !_gol_chunk_add(universe, cx + 1, cy)) return false;
+    if ((top & 1) && !_gol_chunk_add(universe, cx - 1, cy - 1)) return false;
+    if ((top >> 63) && !_gol_chunk_add(universe, cx + 1, cy - 1)) return false;
+    if ((bottom & 1) && !_gol_chunk_add(universe, cx - 1, cy + 1)) return false;
+    if ((bottom >> 63) && !_gol_chunk_add(universe, cx + 1, cy + 1)) return false;
+    return true;
+}
+
+/* Fetches row *y* of the chunk in the middle of *around*, which may range
+ * from -1 to 64, shifted to the west and the east. */
+static void _gol_chunk_row(
+        gol_chunk_t* const around[9], int parity, int y, uint64_t* west,
+        uint64_t* row, uint64_t* east) {
+    int r = 1;
+    if (y < 0) {
+        r = 0;
+        y += GOL_CHUNK_SIZE;
+    }
+    else if (y >= GOL_CHUNK_SIZE) {
+        r = 2;
+        y -= GOL_CHUNK_SIZE;
+    }
+    uint64_t w = around[r * 3] ? around[r * 3]->rows[parity][y] : 0;
+    uint64_t c = around[r * 3 + 1] ? around[r * 3 + 1]->rows[parity][y] : 0;
+    uint64_t e = around[r * 3 + 2] ? around[r * 3 + 2]->rows[parity][y] : 0;
+    *west = (c << 1) | (w >> 63);
+    *row = c;
+    *east = (c >> 1) | (e << 63);
+}
+
+/* Calculates the next generation of a chunk with the compiled rule of the
+ * universe. */
+static void _gol_chunk_step(
+        const gol_universe_t* universe, gol_chunk_t* chunk, int parity,
+        const gol_rule_compiled_t* rule) {
+    gol_chunk_t* around[9];
+    int dx, dy, y;
+    for (dy=-1; dy <= 1; dy++) {
+        for (dx=-1; dx <= 1; dx++) {
+            around[(dy + 1) * 3 + dx + 1] = _gol_chunk_get(
+                    universe, chunk->cx + dx, chunk->cy + dy);
+        }
+    }
+
+    uint64_t aw, a, ae, rw, r, re, bw, b, be;
+    _gol_chunk_row(around, parity, -1, &aw, &a, &ae);
+    _gol_chunk_row(around, parity, 0, &rw, &r, &re);
+    for (y=0; y < GOL_CHUNK_SIZE; y++) {
+        _gol_chunk_row(around, parity, y + 1, &bw, &b, &be);
+        chunk->rows[parity ^ 1][y] = gol_kernel_next_word(
+                aw, a, ae, rw, r, re, bw, b, be, rule);
+        aw = rw; a = r; ae = re;
+        rw = bw; r = b; re = be;
+    }
+}
+
+
+gol_universe_t* gol_universe_create(void) {
+    gol_universe_t* universe = malloc(sizeof(gol_universe_t));
+    if (universe == NULL) return NULL;
+
+    universe->generation = 0;
+    universe->chunk_count = 0;
+    universe->chunk_capacity = 16;
+    universe->chunks = malloc(sizeof(gol_chunk_t*) * universe->chunk_capacity);
+    universe->table_mask = 31;
+    universe->table = calloc(universe->table_mask + 1, sizeof(gol_chunk_t*));
+    if (universe->chunks == NULL || universe->table == NULL) {
+        free(universe->chunks);
+        free(universe->table);
+        free(universe);
+        return NULL;
+    }
+
+    universe->rule = gol_rule_conway();
+    return universe;
+}
+
+void gol_universe_destroy(gol_universe_t* universe) {
+    if (universe) {
+        size_t i;
+        for (i=0; i < universe->chunk_count; i++) {
+            free(universe->chunks[i]);
+        }
+        free(universe->chunks);
+        free(universe->table);
+        free(universe);
+    }
+}
+
+bool gol_universe_cell(const gol_universe_t* universe, int64_t x, int64_t y) {
+    int64_t cx = _gol_chunk_coord(x);
+    int64_t cy = _gol_chunk_coord(y);
+    const gol_chunk_t* chunk = _gol_chunk_get(universe, cx, cy);
+    if (chunk == NULL) return false;
+    uint64_t row = chunk->rows[universe->generation & 1][y - cy * GOL_CHUNK_SIZE];
+    return (row >> (x - cx * GOL_CHUNK_SIZE)) & 1;
+}
+
+bool gol_universe_cell_set(
+        gol_universe_t* universe, int64_t x, int64_t y, bool state) {
+    int64_t cx = _gol_chunk_coord(x);
+    int64_t cy = _gol_chunk_coord(y);
+    gol_chunk_t* chunk = _gol_chunk_get(universe, cx, cy);
+    if (chunk == NULL) {
+        if (!state) return true;
+        chunk = _gol_chunk_add(universe, cx, cy);
+        if (chunk == NULL) return false;
+    }
+
+    uint64_t* row = &chunk->rows[universe->generation & 1][y - cy * GOL_CHUNK_SIZE];
+    uint64_t bit = (uint64_t) 1 << (x - cx * GOL_CHUNK_SIZE);
+    if (state) *row |= bit;
+    else *row &= ~bit;
+    return true;
+}
+
+bool gol_universe_set_rule(gol_universe_t* universe, const char* rule) {
+    gol_rule_t parsed;
+    if (!gol_rule_parse(rule, &parsed)) return false;
+    if (gol_rule_births_from_nothing(parsed)) return false;
+    universe->rule = parsed;
+    return true;
+}
+
+bool gol_universe_next_generation(gol_universe_t* universe) {
+    int parity = universe->generation & 1;
+    size_t count = universe->chunk_count;
+    gol_rule_compiled_t rule;
+    size_t i;
+
+    /* Only allocated chunks are calculated, so the empty space has to
+     * stay empty. */
+    if (gol_rule_births_from_nothing(universe->rule)) return false;
+
+    /* Allocate the chunks that the pattern grows into. Chunks added here
+     * are empty and appended, so the loop only visits the original ones. */
+    for (i=0; i < count; i++) {
+        if (!_gol_chunk_grow(universe, universe->chunks[i], parity)) {
+            return false;
+        }
+    }
+
+    /* The rule is compiled once for all chunks of the generation. */
+    gol_rule_compile(universe->rule, &rule);
+    for (i=0; i < universe->chunk_count; i++) {
+        _gol_chunk_step(universe, universe->chunks[i], parity, &rule);
+    }
+    universe->generation++;
+
+    /* Free the chunks that are empty now. */
+    i = universe->chunk_count;
+    while (i-- > 0) {
+        gol_chunk_t* chunk = universe->chunks[i];
+        if (!_gol_rows_alive(chunk->rows[parity ^ 1])) {
+            _gol_chunk_remove(universe, chunk);
+        }
+    }
+    return true;
+}
+
+uint64_t gol_universe_population(const gol_universe_t* universe) {
+    int parity = universe->generation & 1;
+    uint64_t population = 0;
+    size_t i;
+    int y;
+    for (i=0; i < universe->chunk_count; i++) {
+        for (y=0; y < GOL_CHUNK_SIZE; y++) {
+            population += __builtin_popcountll(universe->chunks[i]->rows[parity][y]);
+        }
+    }
+    return population;
+}
+
+bool gol_universe_import(
+        gol_universe_t* universe, const game_of_life_t* game, int64_t x,
+        int64_t y) {
+    uint32_t i, j;
+    for (j=0; j < game->height; j++) {
+        const uint64_t* row = game_of_life_row(game, j);
+        for (i=0; i < game->stride; i++) {
+            uint64_t word = row[i];
+            while (word) {
+                int bit = __builtin_ctzll(word);
+                word &= word - 1;
+                if (!gol_universe_cell_set(universe, x + i * 64 + bit, y + j, true)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void gol_universe_export(
+        const gol_universe_t* universe, game_of_life_t* game, int64_t x,
+        int64_t y) {
+    int parity = universe->generation & 1;
+    uint32_t j;
+    size_t i;
+    for (j=0; j < game->height; j++) {
+        memset(game_of_life_row(game, j), 0, sizeof(uint64_t) * game->stride);
+    }
+
+    /* Place the rows of every chunk that overlaps the window into the
+     * board, a word at a time. */
+    for (i=0; i < universe->chunk_count; i++) {
+        const gol_chunk_t* chunk = universe->chunks[i];
+        int64_t left = chunk->cx * GOL_CHUNK_SIZE - x;
+        int64_t top = chunk->cy * GOL_CHUNK_SIZE - y;
+        if (left >= game->width || left + GOL_CHUNK_SIZE <= 0) continue;
+        if (top >= game->height || top + GOL_CHUNK_SIZE <= 0) continue;
+
+        int r;
+        for (r=0; r < GOL_CHUNK_SIZE; r++) {
+            if (top + r < 0 || top + r >= game->height) continue;
+            uint64_t word = chunk->rows[parity][r];
+            uint64_t* row = game_of_life_row(game, top + r);
+            if (word == 0) continue;
+
+            if (left < 0) {
+                row[0] |= word >> -left;
+                continue;
+            }
+            uint32_t w = left / 64;
+            uint32_t shift = left % 64;
+            row[w] |= word << shift;
+            if (shift && w + 1 < game->stride) {
+                row[w + 1] |= word >> (64 - shift);
+            }
+        }
+    }
+
+    /* Clear the cells that were placed beyond the width of the board. */
+    if (game->width % 64) {
+        uint64_t mask = ((uint64_t) 1 << (game->width % 64)) - 1;
+        for (j=0; j < game->height; j++) {
+            game_of_life_row(game, j)[game->stride - 1] &= mask;
+        }
+    }
+    game_of_life_wake(game);
+}
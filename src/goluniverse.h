@@ -0,0 +1,108 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: goluniverse.h
+ * description: Unbounded sparse Game of Life universe
+ * author: Donkey Coding Group
+ *
+ * This C header defines a Game of Life universe without any edges. The
+ * universe is made up of chunks of 64x64 cells that are kept in a hash map
+ * by their 64-bit coordinates. Chunks are allocated when the pattern grows
+ * into them and freed as soon as they are empty, so the memory stays
+ * proportional to the live region, no matter how far apart the parts of
+ * the pattern travel. */
+
+#ifndef NIKLASROSENSTEIN_GAME_OF_LIFE_UNIVERSE
+#define NIKLASROSENSTEIN_GAME_OF_LIFE_UNIVERSE
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "gol.h"
+
+/* The number of cells along each side of a chunk. */
+#define GOL_CHUNK_SIZE 64
+
+typedef struct _gol_chunk gol_chunk_t;
+
+/* This structure represents an unbounded universe of the Game of Life. */
+typedef struct _gol_universe {
+    /* The number of generations that have been passed since the creation
+     * of the universe. */
+    uint64_t generation;
+
+    /* The allocated chunks, in no particular order. */
+    gol_chunk_t** chunks;
+    size_t chunk_count;
+    size_t chunk_capacity;
+
+    /* Open addressing hash map from chunk coordinates to chunks. The size
+     * of the table is a power of two. */
+    gol_chunk_t** table;
+    size_t table_mask;
+
+    /* The rule of the universe, see :class:`game_of_life_t`. Rules that
+     * give birth to cells without neighbours are not supported. */
+    gol_rule_t rule;
+} gol_universe_t;
+
+/* Create a new, empty universe with Conway's rules. Returns NULL if memory
+ * allocation failed. */
+gol_universe_t* gol_universe_create(void);
+
+/* Destroy a universe created with :func:`gol_universe_create`. */
+void gol_universe_destroy(gol_universe_t* universe);
+
+/* Returns the state of the cell at the specified coordinate. */
+bool gol_universe_cell(const gol_universe_t* universe, int64_t x, int64_t y);
+
+/* Set the state of a cell. Returns false if the chunk of the cell could not
+ * be allocated. */
+bool gol_universe_cell_set(
+        gol_universe_t* universe, int64_t x, int64_t y, bool state);
+
+/* Set the rule of the universe from a rule string, see
+ * :func:`gol_rule_parse`. Returns false and leaves the rule unchanged if
+ * the string is not a valid rule or gives birth to cells without
+ * neighbours. */
+bool gol_universe_set_rule(gol_universe_t* universe, const char* rule);
+
+/* Bring the universe into its next generation. Returns false if memory
+ * allocation failed or the rule is not supported, in which case the
+ * universe is unchanged. */
+bool gol_universe_next_generation(gol_universe_t* universe);
+
+/* Returns the number of living cells in the universe. */
+uint64_t gol_universe_population(const gol_universe_t* universe);
+
+/* Copy the living cells of a board into the universe, with the top-left
+ * corner of the board at (x, y). Returns false if memory allocation
+ * failed. */
+bool gol_universe_import(
+        gol_universe_t* universe, const game_of_life_t* game, int64_t x,
+        int64_t y);
+
+/* Copy the cells of the universe in the window of the size of the board
+ * with its top-left corner at (x, y) into the board. */
+void gol_universe_export(
+        const gol_universe_t* universe, game_of_life_t* game, int64_t x,
+        int64_t y);
+
+#endif /* NIKLASROSENSTEIN_GAME_OF_LIFE_UNIVERSE */
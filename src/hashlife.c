@@ -0,0 +1,718 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: hashlife.c
+ * description: Hashlife engine for the Game of Life
+ * author: Donkey Coding Group */
+
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include "hashlife.h"
+#include "golkernel.h"
+
+/* The level of the leaf nodes. A node of level *k* covers 2^k x 2^k cells,
+ * the leaves store their 8x8 cells as a bitmap. */
+#define HL_LEAF_LEVEL 3
+
+/* The highest level of a node, so that coordinates fit into 64 bits. */
+#define HL_MAX_LEVEL 60
+
+/* The default bound of the node cache and its initial capacity. */
+#define HL_DEFAULT_MAX_NODES (1 << 20)
+#define HL_INITIAL_CAPACITY (1 << 12)
+
+/* Shortcut to access a node by its index. Indices must be used to refer to
+ * nodes, as the node array moves when it grows. */
+#define N(i) (life->nodes[i])
+
+
+/* A node of the quadtree. Nodes are referred to by their index into the
+ * node array, the index zero is never used. */
+typedef struct _hl_node {
+    union {
+        /* The quadrants of an inner node: nw, ne, sw, se. */
+        uint32_t child[4];
+
+        /* The cells of a leaf, bit ``x + y * 8`` is the cell (x, y). */
+        uint64_t bits;
+    } u;
+
+    /* The next node in the same hash bucket or the free list. */
+    uint32_t next;
+
+    /* The centre of the node advanced by 2^result_log generations, or
+     * zero if it has not been calculated yet. */
+    uint32_t result;
+    uint8_t result_log;
+
+    /* The level of the node, zero for nodes on the free list. */
+    uint8_t level;
+
+    /* Set for reachable nodes during garbage collection. */
+    uint8_t mark;
+} hl_node_t;
+
+struct _hashlife {
+    /* The node array and its hash table, whose buckets are chained
+     * through :attr:`hl_node_t.next`. */
+    hl_node_t* nodes;
+    uint32_t capacity;
+    uint32_t used;
+    uint32_t live;
+    uint32_t free_list;
+    size_t max_nodes;
+    uint32_t* table;
+    uint32_t table_mask;
+
+    /* The empty node of every level, created on demand. */
+    uint32_t empty[HL_MAX_LEVEL + 1];
+
+    /* Nodes that are being worked with and must survive a garbage
+     * collection in the middle of a calculation. */
+    uint32_t* stack;
+    size_t stack_size;
+    size_t stack_capacity;
+
+    /* Jumped to when memory allocation fails during a calculation. */
+    jmp_buf* failure;
+
+    /* The pattern and the position of its top-left corner. */
+    uint32_t root;
+    int64_t x;
+    int64_t y;
+    uint64_t generation;
+
+    /* The log2 of the generations the results are calculated for. */
+    unsigned step_log;
+
+    /* The rule the memoised results were calculated with, and its compiled
+     * form. */
+    gol_rule_t rule;
+    gol_rule_compiled_t compiled;
+};
+
+
+/* Abort the current calculation. */
+static void _hl_fail(hashlife_t* life) {
+    longjmp(*life->failure, 1);
+}
+
+static uint32_t _hl_hash(const hl_node_t* node) {
+    uint64_t h;
+    if (node->level == HL_LEAF_LEVEL) {
+        h = node->u.bits;
+    }
+    else {
+        h = node->u.child[0] + 0x9e3779b97f4a7c15ull * node->u.child[1];
+        h = h * 0xbf58476d1ce4e5b9ull + node->u.child[2];
+        h = h * 0x94d049bb133111ebull + node->u.child[3];
+        h += node->level;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return (uint32_t) h;
+}
+
+static bool _hl_equal(const hl_node_t* a, const hl_node_t* b) {
+    if (a->level != b->level) return false;
+    if (a->level == HL_LEAF_LEVEL) return a->u.bits == b->u.bits;
+    return memcmp(a->u.child, b->u.child, sizeof(a->u.child)) == 0;
+}
+
+/* Rebuild the hash table from the nodes in use. */
+static void _hl_rehash(hashlife_t* life) {
+    uint32_t i;
+    memset(life->table, 0, sizeof(uint32_t) * (life->table_mask + 1));
+    for (i=1; i < life->used; i++) {
+        if (N(i).level == 0) continue;
+        uint32_t* bucket = &life->table[_hl_hash(&N(i)) & life->table_mask];
+        N(i).next = *bucket;
+        *bucket = i;
+    }
+}
+
+/* Double the capacity of the node array and the hash table. */
+static void _hl_grow(hashlife_t* life) {
+    uint32_t capacity = life->capacity * 2;
+    if (capacity <= life->capacity) _hl_fail(life);
+
+    hl_node_t* nodes = realloc(life->nodes, sizeof(hl_node_t) * capacity);
+    if (nodes == NULL) _hl_fail(life);
+    life->nodes = nodes;
+
+    uint32_t* table = realloc(life->table, sizeof(uint32_t) * capacity);
+    if (table == NULL) _hl_fail(life);
+    life->table = table;
+
+    life->capacity = capacity;
+    life->table_mask = capacity - 1;
+    _hl_rehash(life);
+}
+
+static void _hl_mark(hashlife_t* life, uint32_t i) {
+    if (i == 0 || N(i).mark) return;
+    N(i).mark = 1;
+    if (N(i).level > HL_LEAF_LEVEL) {
+        int c;
+        for (c=0; c < 4; c++) _hl_mark(life, N(i).u.child[c]);
+    }
+}
+
+/* Free all nodes that are not reachable from the pattern, the empty nodes
+ * or the stack, and the results that refer to freed nodes. */
+static void _hl_collect(hashlife_t* life) {
+    uint32_t i;
+    size_t s;
+    for (i=1; i < life->used; i++) {
+        N(i).mark = 0;
+    }
+    _hl_mark(life, life->root);
+    for (i=0; i <= HL_MAX_LEVEL; i++) {
+        _hl_mark(life, life->empty[i]);
+    }
+    for (s=0; s < life->stack_size; s++) {
+        _hl_mark(life, life->stack[s]);
+    }
+
+    life->free_list = 0;
+    life->live = 0;
+    for (i=life->used - 1; i > 0; i--) {
+        if (N(i).level != 0 && N(i).mark) {
+            if (N(i).result && !N(N(i).result).mark) N(i).result = 0;
+            life->live++;
+        }
+        else {
+            N(i).level = 0;
+            N(i).result = 0;
+            N(i).next = life->free_list;
+            life->free_list = i;
+        }
+    }
+    _hl_rehash(life);
+}
+
+/* Returns the index of an unused node. */
+static uint32_t _hl_alloc(hashlife_t* life) {
+    if (life->free_list == 0 && life->used == life->capacity) {
+        if (life->capacity >= life->max_nodes) _hl_collect(life);
+        if (life->free_list == 0 || life->live > life->capacity / 4 * 3) {
+            _hl_grow(life);
+        }
+    }
+
+    uint32_t i;
+    if (life->free_list) {
+        i = life->free_list;
+        life->free_list = N(i).next;
+    }
+    else {
+        i = life->used++;
+    }
+    life->live++;
+    return i;
+}
+
+/* Returns the node equal to *key*, creating it if it doesn't exist yet. */
+static uint32_t _hl_intern(hashlife_t* life, const hl_node_t* key) {
+    uint32_t h = _hl_hash(key);
+    uint32_t i = life->table[h & life->table_mask];
+    while (i) {
+        if (_hl_equal(&N(i), key)) return i;
+        i = N(i).next;
+    }
+
+    /* Allocating may collect garbage or grow the table, so the bucket is
+     * looked up afterwards. */
+    i = _hl_alloc(life);
+    N(i) = *key;
+    N(i).result = 0;
+    N(i).result_log = 0;
+    N(i).mark = 0;
+    uint32_t* bucket = &life->table[h & life->table_mask];
+    N(i).next = *bucket;
+    *bucket = i;
+    return i;
+}
+
+static uint32_t _hl_leaf(hashlife_t* life, uint64_t bits) {
+    hl_node_t key;
+    memset(&key, 0, sizeof(key));
+    key.level = HL_LEAF_LEVEL;
+    key.u.bits = bits;
+    return _hl_intern(life, &key);
+}
+
+/* Returns the node made up of the four quadrants. The quadrants must be
+ * reachable from the stack or the pattern. */
+static uint32_t _hl_join(
+        hashlife_t* life, uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se) {
+    hl_node_t key;
+    memset(&key, 0, sizeof(key));
+    key.level = N(nw).level + 1;
+    key.u.child[0] = nw;
+    key.u.child[1] = ne;
+    key.u.child[2] = sw;
+    key.u.child[3] = se;
+    return _hl_intern(life, &key);
+}
+
+/* Push a node onto the stack, protecting it from garbage collection. */
+static uint32_t _hl_push(hashlife_t* life, uint32_t i) {
+    if (life->stack_size == life->stack_capacity) {
+        size_t capacity = life->stack_capacity * 2;
+        uint32_t* stack = realloc(life->stack, sizeof(uint32_t) * capacity);
+        if (stack == NULL) _hl_fail(life);
+        life->stack = stack;
+        life->stack_capacity = capacity;
+    }
+    life->stack[life->stack_size++] = i;
+    return i;
+}
+
+static uint32_t _hl_empty(hashlife_t* life, unsigned level) {
+    if (life->empty[level] == 0) {
+        uint32_t node;
+        if (level == HL_LEAF_LEVEL) {
+            node = _hl_leaf(life, 0);
+        }
+        else {
+            uint32_t e = _hl_empty(life, level - 1);
+            node = _hl_join(life, e, e, e, e);
+        }
+        life->empty[level] = node;
+    }
+    return life->empty[level];
+}
+
+/* Fills the 16 rows of cells of a node one level above the leaves. */
+static void _hl_rows16(const hashlife_t* life, uint32_t n, uint32_t rows[16]) {
+    uint64_t nw = N(N(n).u.child[0]).u.bits;
+    uint64_t ne = N(N(n).u.child[1]).u.bits;
+    uint64_t sw = N(N(n).u.child[2]).u.bits;
+    uint64_t se = N(N(n).u.child[3]).u.bits;
+    int y;
+    for (y=0; y < 8; y++) {
+        rows[y] = ((nw >> (y * 8)) & 0xff) | (((ne >> (y * 8)) & 0xff) << 8);
+        rows[y + 8] = ((sw >> (y * 8)) & 0xff) | (((se >> (y * 8)) & 0xff) << 8);
+    }
+}
+
+/* Returns the leaf of the centre 8x8 cells of 16 rows. */
+static uint32_t _hl_leaf16(hashlife_t* life, const uint32_t rows[16]) {
+    uint64_t bits = 0;
+    int y;
+    for (y=0; y < 8; y++) {
+        bits |= (uint64_t) ((rows[y + 4] >> 4) & 0xff) << (y * 8);
+    }
+    return _hl_leaf(life, bits);
+}
+
+/* Calculates the next generation of 16 rows of cells. Cells outside of
+ * the rows count as dead, so the outermost cells become invalid with every
+ * generation. */
+static void _hl_step16(uint32_t rows[16], const gol_rule_compiled_t* rule) {
+    uint32_t next[16];
+    int y, k;
+    for (y=0; y < 16; y++) {
+        uint32_t a = y > 0 ? rows[y - 1] : 0;
+        uint32_t r = rows[y];
+        uint32_t b = y < 15 ? rows[y + 1] : 0;
+        uint32_t in[8] = { a << 1, a, a >> 1, r << 1, r >> 1, b << 1, b, b >> 1 };
+
+        /* Add up the neighbours into the bit planes of a counter. */
+        uint32_t n1 = 0, n2 = 0, n4 = 0, n8 = 0;
+        for (k=0; k < 8; k++) {
+            uint32_t c1 = n1 & in[k];
+            n1 ^= in[k];
+            uint32_t c2 = n2 & c1;
+            n2 ^= c1;
+            uint32_t c4 = n4 & c2;
+            n4 ^= c2;
+            n8 |= c4;
+        }
+
+        next[y] = gol_kernel_apply_rule(r, n1, n2, n4, n8, rule) & 0xffff;
+    }
+    memcpy(rows, next, sizeof(next));
+}
+
+/* Returns the centre of a node, one level below it. */
+static uint32_t _hl_centre(hashlife_t* life, uint32_t n) {
+    if (N(n).level == HL_LEAF_LEVEL + 1) {
+        uint32_t rows[16];
+        _hl_rows16(life, n, rows);
+        return _hl_leaf16(life, rows);
+    }
+    uint32_t nw = N(N(n).u.child[0]).u.child[3];
+    uint32_t ne = N(N(n).u.child[1]).u.child[2];
+    uint32_t sw = N(N(n).u.child[2]).u.child[1];
+    uint32_t se = N(N(n).u.child[3]).u.child[0];
+    return _hl_join(life, nw, ne, sw, se);
+}
+
+/* Returns the centre of a node advanced by 2^j generations, where *j* is
+ * the step of the universe but at most two less than the node's level. */
+static uint32_t _hl_result(hashlife_t* life, uint32_t n) {
+    unsigned level = N(n).level;
+    unsigned log = life->step_log < level - 2 ? life->step_log : level - 2;
+    if (N(n).result && N(n).result_log == log) {
+        return N(n).result;
+    }
+
+    size_t top = life->stack_size;
+    uint32_t result;
+
+    if (n == life->empty[level]) {
+        result = _hl_empty(life, level - 1);
+    }
+    else if (level == HL_LEAF_LEVEL + 1) {
+        uint32_t rows[16];
+        int i;
+        _hl_rows16(life, n, rows);
+        for (i=0; i < (1 << log); i++) {
+            _hl_step16(rows, &life->compiled);
+        }
+        result = _hl_leaf16(life, rows);
+    }
+    else {
+        uint32_t g[4][4];
+        uint32_t m[9], r[4];
+        int i, c;
+        for (i=0; i < 4; i++) {
+            for (c=0; c < 4; c++) g[i][c] = N(N(n).u.child[i]).u.child[c];
+        }
+
+        /* The nine overlapping sub-squares one level below the node. */
+        m[0] = N(n).u.child[0];
+        m[2] = N(n).u.child[1];
+        m[6] = N(n).u.child[2];
+        m[8] = N(n).u.child[3];
+        m[1] = _hl_push(life, _hl_join(life, g[0][1], g[1][0], g[0][3], g[1][2]));
+        m[3] = _hl_push(life, _hl_join(life, g[0][2], g[0][3], g[2][0], g[2][1]));
+        m[4] = _hl_push(life, _hl_join(life, g[0][3], g[1][2], g[2][1], g[3][0]));
+        m[5] = _hl_push(life, _hl_join(life, g[1][2], g[1][3], g[3][0], g[3][1]));
+        m[7] = _hl_push(life, _hl_join(life, g[2][1], g[3][0], g[2][3], g[3][2]));
+
+        /* At full speed the sub-squares are advanced by half of the
+         * generations, otherwise all generations happen in the second
+         * half below. */
+        for (i=0; i < 9; i++) {
+            if (log == level - 2) m[i] = _hl_push(life, _hl_result(life, m[i]));
+            else m[i] = _hl_push(life, _hl_centre(life, m[i]));
+        }
+
+        r[0] = _hl_push(life, _hl_join(life, m[0], m[1], m[3], m[4]));
+        r[1] = _hl_push(life, _hl_join(life, m[1], m[2], m[4], m[5]));
+        r[2] = _hl_push(life, _hl_join(life, m[3], m[4], m[6], m[7]));
+        r[3] = _hl_push(life, _hl_join(life, m[4], m[5], m[7], m[8]));
+        for (i=0; i < 4; i++) {
+            r[i] = _hl_push(life, _hl_result(life, r[i]));
+        }
+        result = _hl_join(life, r[0], r[1], r[2], r[3]);
+    }
+
+    life->stack_size = top;
+    N(n).result = result;
+    N(n).result_log = log;
+    return result;
+}
+
+/* Returns true if the pattern of the node lies within its centre. */
+static bool _hl_centred(hashlife_t* life, uint32_t n) {
+    unsigned level = N(n).level;
+    if (level < HL_LEAF_LEVEL + 2) return false;
+    uint32_t e = _hl_empty(life, level - 2);
+    const uint32_t* nw = N(N(n).u.child[0]).u.child;
+    const uint32_t* ne = N(N(n).u.child[1]).u.child;
+    const uint32_t* sw = N(N(n).u.child[2]).u.child;
+    const uint32_t* se = N(N(n).u.child[3]).u.child;
+    return nw[0] == e && nw[1] == e && nw[2] == e &&
+           ne[0] == e && ne[1] == e && ne[3] == e &&
+           sw[0] == e && sw[2] == e && sw[3] == e &&
+           se[1] == e && se[2] == e && se[3] == e;
+}
+
+/* Returns the node one level above *n* with *n* in its centre. */
+static uint32_t _hl_expand(hashlife_t* life, uint32_t n) {
+    unsigned level = N(n).level;
+    if (level >= HL_MAX_LEVEL) _hl_fail(life);
+    uint32_t e = _hl_push(life, _hl_empty(life, level - 1));
+    uint32_t nw = _hl_push(life, _hl_join(life, e, e, e, N(n).u.child[0]));
+    uint32_t ne = _hl_push(life, _hl_join(life, e, e, N(n).u.child[1], e));
+    uint32_t sw = _hl_push(life, _hl_join(life, e, N(n).u.child[2], e, e));
+    uint32_t se = _hl_push(life, _hl_join(life, N(n).u.child[3], e, e, e));
+    return _hl_join(life, nw, ne, sw, se);
+}
+
+/* Returns the node of the specified level that covers the cells of the
+ * board from (x, y) on. */
+static uint32_t _hl_build(
+        hashlife_t* life, const game_of_life_t* game, uint32_t x, uint32_t y,
+        unsigned level) {
+    if (x >= game->width || y >= game->height) {
+        return _hl_empty(life, level);
+    }
+    if (level == HL_LEAF_LEVEL) {
+        uint64_t bits = 0;
+        uint32_t r;
+        for (r=0; r < 8 && y + r < game->height; r++) {
+            const uint64_t* row = game_of_life_row(game, y + r);
+            bits |= ((row[x / 64] >> (x % 64)) & 0xff) << (r * 8);
+        }
+        return _hl_leaf(life, bits);
+    }
+    uint32_t half = (uint32_t) 1 << (level - 1);
+    uint32_t nw = _hl_push(life, _hl_build(life, game, x, y, level - 1));
+    uint32_t ne = _hl_push(life, _hl_build(life, game, x + half, y, level - 1));
+    uint32_t sw = _hl_push(life, _hl_build(life, game, x, y + half, level - 1));
+    uint32_t se = _hl_push(life, _hl_build(life, game, x + half, y + half, level - 1));
+    return _hl_join(life, nw, ne, sw, se);
+}
+
+/* Writes the cells of the node at (x, y) that lie in the board. */
+static void _hl_write(
+        const hashlife_t* life, game_of_life_t* game, uint32_t n, int64_t x,
+        int64_t y) {
+    unsigned level = N(n).level;
+    int64_t size = (int64_t) 1 << level;
+    if (n == life->empty[level]) return;
+    if (x >= game->width || y >= game->height || x + size <= 0 || y + size <= 0) {
+        return;
+    }
+
+    if (level == HL_LEAF_LEVEL) {
+        /* Leaves are always aligned to 8 cells, so each row of a leaf
+         * lies in a single word. */
+        uint64_t bits = N(n).u.bits;
+        uint64_t mask = 0xff;
+        int r;
+        if (x + 8 > game->width) mask = ((uint64_t) 1 << (game->width - x)) - 1;
+        for (r=0; r < 8; r++) {
+            if (y + r < 0 || y + r >= game->height) continue;
+            uint64_t* row = game_of_life_row(game, y + r);
+            row[x / 64] |= ((bits >> (r * 8)) & mask) << (x % 64);
+        }
+        return;
+    }
+
+    int64_t half = size / 2;
+    _hl_write(life, game, N(n).u.child[0], x, y);
+    _hl_write(life, game, N(n).u.child[1], x + half, y);
+    _hl_write(life, game, N(n).u.child[2], x, y + half);
+    _hl_write(life, game, N(n).u.child[3], x + half, y + half);
+}
+
+
+/* Runs *task* with failures of memory allocation caught, returns false if
+ * one occurred. Tasks must only modify the universe once nothing can fail
+ * anymore. */
+static bool _hl_try(
+        hashlife_t* life, void (*task)(hashlife_t*, void*), void* arg) {
+    jmp_buf failure;
+    if (setjmp(failure)) {
+        life->stack_size = 0;
+        life->failure = NULL;
+        return false;
+    }
+    life->failure = &failure;
+    task(life, arg);
+    life->stack_size = 0;
+    life->failure = NULL;
+    return true;
+}
+
+static void _hl_create_task(hashlife_t* life, void* arg) {
+    life->root = _hl_empty(life, HL_LEAF_LEVEL + 1);
+}
+
+static void _hl_import_task(hashlife_t* life, void* arg) {
+    const game_of_life_t* game = arg;
+    unsigned level = HL_LEAF_LEVEL + 1;
+    while (((uint64_t) 1 << level) < game->width ||
+           ((uint64_t) 1 << level) < game->height) {
+        level++;
+    }
+    uint32_t root = _hl_build(life, game, 0, 0, level);
+
+    life->root = root;
+    life->x = 0;
+    life->y = 0;
+    life->generation = game->generation;
+}
+
+static void _hl_advance_task(hashlife_t* life, void* arg) {
+    unsigned k = *(const unsigned*) arg;
+
+    /* Expand the universe until it is large enough to be advanced by 2^k
+     * generations with the pattern in its centre, and once more so that
+     * the pattern can't grow beyond the centre in that time. */
+    uint32_t root = _hl_push(life, life->root);
+    int64_t x = life->x;
+    int64_t y = life->y;
+    bool margin = false;
+    while (!margin) {
+        margin = N(root).level >= k + 2 && _hl_centred(life, root);
+        int64_t half = (int64_t) 1 << (N(root).level - 1);
+        root = _hl_push(life, _hl_expand(life, root));
+        x -= half;
+        y -= half;
+    }
+
+    life->step_log = k;
+    int64_t quarter = (int64_t) 1 << (N(root).level - 2);
+    root = _hl_push(life, _hl_result(life, root));
+    x += quarter;
+    y += quarter;
+
+    /* Shrink the universe back around the pattern. */
+    while (_hl_centred(life, root)) {
+        int64_t offset = (int64_t) 1 << (N(root).level - 2);
+        root = _hl_push(life, _hl_centre(life, root));
+        x += offset;
+        y += offset;
+    }
+
+    life->root = root;
+    life->x = x;
+    life->y = y;
+    life->generation += (uint64_t) 1 << k;
+}
+
+
+hashlife_t* hashlife_create(size_t max_nodes) {
+    hashlife_t* life = malloc(sizeof(hashlife_t));
+    if (life == NULL) return NULL;
+    memset(life, 0, sizeof(hashlife_t));
+
+    /* The node array starts out small, but no larger than the bound so
+     * that it is actually collected at the bound. */
+    if (max_nodes == 0) max_nodes = HL_DEFAULT_MAX_NODES;
+    life->max_nodes = max_nodes;
+    life->capacity = 64;
+    while (life->capacity < HL_INITIAL_CAPACITY && life->capacity < max_nodes) {
+        life->capacity *= 2;
+    }
+    life->table_mask = life->capacity - 1;
+    life->used = 1;
+    life->stack_capacity = 256;
+    life->nodes = malloc(sizeof(hl_node_t) * life->capacity);
+    life->table = calloc(life->capacity, sizeof(uint32_t));
+    life->stack = malloc(sizeof(uint32_t) * life->stack_capacity);
+    if (life->nodes == NULL || life->table == NULL || life->stack == NULL) {
+        hashlife_destroy(life);
+        return NULL;
+    }
+
+    life->rule = gol_rule_conway();
+    gol_rule_compile(life->rule, &life->compiled);
+
+    if (!_hl_try(life, _hl_create_task, NULL)) {
+        hashlife_destroy(life);
+        return NULL;
+    }
+    return life;
+}
+
+void hashlife_destroy(hashlife_t* life) {
+    if (life) {
+        free(life->nodes);
+        free(life->table);
+        free(life->stack);
+        free(life);
+    }
+}
+
+bool hashlife_import(hashlife_t* life, const game_of_life_t* game) {
+    /* Rules that give birth to cells without neighbours would fill the
+     * infinite empty space around the pattern. */
+    if (gol_rule_births_from_nothing(game->rule)) return false;
+
+    /* Larger than Life neighbourhoods reach beyond the 4x4 blocks that
+     * the results are built from. */
+    if (game->ltl.range) return false;
+
+    /* Memoised results are only valid for the rule they were calculated
+     * with. */
+    if (game->rule.birth != life->rule.birth ||
+            game->rule.survival != life->rule.survival) {
+        uint32_t i;
+        for (i=1; i < life->used; i++) N(i).result = 0;
+        life->rule = game->rule;
+        gol_rule_compile(life->rule, &life->compiled);
+    }
+
+    return _hl_try(life, _hl_import_task, (void*) game);
+}
+
+void hashlife_export(const hashlife_t* life, game_of_life_t* game) {
+    uint32_t j;
+    for (j=0; j < game->height; j++) {
+        memset(game_of_life_row(game, j), 0, sizeof(uint64_t) * game->stride);
+    }
+    _hl_write(life, game, life->root, life->x, life->y);
+    game_of_life_wake(game);
+    game->generation = life->generation;
+}
+
+bool hashlife_advance(hashlife_t* life, unsigned k) {
+    if (k + 3 > HL_MAX_LEVEL) return false;
+    return _hl_try(life, _hl_advance_task, &k);
+}
+
+bool hashlife_advance_by(hashlife_t* life, uint64_t generations) {
+    unsigned k;
+    for (k=0; k < 64; k++) {
+        if (((generations >> k) & 1) && !hashlife_advance(life, k)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t hashlife_generation(const hashlife_t* life) {
+    return life->generation;
+}
+
+bool hashlife_cell(const hashlife_t* life, int64_t x, int64_t y) {
+    uint32_t n = life->root;
+    x -= life->x;
+    y -= life->y;
+    int64_t size = (int64_t) 1 << N(n).level;
+    if (x < 0 || y < 0 || x >= size || y >= size) return false;
+
+    while (N(n).level > HL_LEAF_LEVEL) {
+        int64_t half = (int64_t) 1 << (N(n).level - 1);
+        int quadrant = (x >= half ? 1 : 0) + (y >= half ? 2 : 0);
+        if (x >= half) x -= half;
+        if (y >= half) y -= half;
+        n = N(n).u.child[quadrant];
+    }
+    return (N(n).u.bits >> (x + y * 8)) & 1;
+}
+
+size_t hashlife_node_count(const hashlife_t* life) {
+    return life->live;
+}
+
+void hashlife_gc(hashlife_t* life) {
+    _hl_collect(life);
+}
@@ -0,0 +1,90 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: hashlife.h
+ * description: Hashlife engine for the Game of Life
+ * author: Donkey Coding Group
+ *
+ * This C header defines a Hashlife universe. The universe is a quadtree of
+ * hash-consed nodes, so identical regions of any size are stored only once,
+ * and the future of every node is memoised. Repetitive patterns such as a
+ * glider gun can thereby be advanced by billions of generations in a few
+ * steps of 2^k generations each.
+ *
+ * The universe is unbounded. A board imported from a :class:`game_of_life_t`
+ * evolves on the infinite plane and is clipped to the board again when it
+ * is exported, so the result matches :func:`game_of_life_next_generation`
+ * only as long as the pattern doesn't reach the edges of the board. */
+
+#ifndef NIKLASROSENSTEIN_HASHLIFE
+#define NIKLASROSENSTEIN_HASHLIFE
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "gol.h"
+
+typedef struct _hashlife hashlife_t;
+
+/* Create an empty Hashlife universe. *max_nodes* bounds the number of
+ * nodes in the cache, zero selects a default of about one million nodes.
+ * When the cache is full, nodes that are no longer reachable and their
+ * memoised results are garbage collected. If the live pattern alone needs
+ * more nodes, the cache grows beyond the bound. Returns NULL if memory
+ * allocation failed. */
+hashlife_t* hashlife_create(size_t max_nodes);
+
+/* Destroy a universe created with :func:`hashlife_create`. */
+void hashlife_destroy(hashlife_t* life);
+
+/* Replace the contents of the universe with the cells of the board, with
+ * the top-left corner of the board at (0, 0). The rules and the generation
+ * of the board are taken over as well. Returns false if memory allocation
+ * failed, in which case the universe keeps its pattern, or if the rules
+ * give birth to cells without any neighbours, which Hashlife can't
+ * simulate on an infinite plane, or are a Larger than Life rule. */
+bool hashlife_import(hashlife_t* life, const game_of_life_t* game);
+
+/* Write the cells of the universe that lie in the bounds of the board into
+ * the board and set its generation. Cells outside the board are lost. */
+void hashlife_export(const hashlife_t* life, game_of_life_t* game);
+
+/* Advance the universe by 2^k generations. Returns false if memory
+ * allocation failed, in which case the universe is unchanged. */
+bool hashlife_advance(hashlife_t* life, unsigned k);
+
+/* Advance the universe by *generations* generations, by advancing it by
+ * each power of two that makes up the number. */
+bool hashlife_advance_by(hashlife_t* life, uint64_t generations);
+
+/* Returns the generation of the universe. */
+uint64_t hashlife_generation(const hashlife_t* life);
+
+/* Returns the state of the cell at the specified coordinate. */
+bool hashlife_cell(const hashlife_t* life, int64_t x, int64_t y);
+
+/* Returns the number of nodes currently held by the cache. */
+size_t hashlife_node_count(const hashlife_t* life);
+
+/* Free all nodes and memoised results that are not reachable from the
+ * current pattern. */
+void hashlife_gc(hashlife_t* life);
+
+#endif /* NIKLASROSENSTEIN_HASHLIFE */
@@ -25,10 +25,15 @@
 #include <inttypes.h>
 
 #include <unistd.h>
+#include <stdio_ext.h>
 // #include <GLUT/glut.h>
 // #include <GL/glfw.h>
 
 #include "gol.h"
+#include "golframe.h"
+#include "golppm.h"
+#include "golpattern.h"
+#include "golprof.h"
 #include "ppm.h"
 #include "ansiescape.h"
 
@@ -42,12 +47,12 @@ typedef struct _gol_printer {
     int max_height;
 } gol_printer_t;
 
-/* Print a Game of Life to the Terminal window (from the current position, the
- * cursor should at least be positioned in the first column. */
-void gol_printer_print(const gol_printer_t* printer, const game_of_life_t* game) {
+/* Print a frame of a Game of Life to the Terminal window (from the current
+ * position, the cursor should at least be positioned in the first column. */
+void gol_printer_print(const gol_printer_t* printer, const gol_frame_t* frame) {
     /* Calculate the actual iteration range. */
-    int width = game->width;
-    int height = game->height;
+    int width = frame->width;
+    int height = frame->height;
     if (printer->max_width > 0 && printer->max_width < width) {
         width = printer->max_width;
     }
@@ -59,25 +64,19 @@ void gol_printer_print(const gol_printer_t* printer, const game_of_life_t* game)
      * superflous characters, so we save the state of the last cell we
      * printed. if it didn't change, we don't have to change our color. */
     bool prev_state = false;
-    bool prev_error = false;
 
     /* Iterate over each cell, lines first. */
     int i, j;
     for (j=0; j < height; j++) {
         for (i=0; i < width; i++) {
             /* Retrieve the current cell. */
-            cell_t* cell = game_of_life_cell(game, i, j);
+            bool state = gol_frame_cell(frame, i, j);
 
-            if (cell == NULL) {
-                prev_error = true;
-                ansiescape_setgraphics("b", ANSICOLOR_RED);
-            }
-            else if (cell->state != prev_state || (i == 0 && j == 0) || prev_error) {
-                ANSICOLOR color = (cell->state ? printer->color_alive : printer->color_dead);
+            if (state != prev_state || (i == 0 && j == 0)) {
+                ANSICOLOR color = (state ? printer->color_alive : printer->color_dead);
                 ansiescape_setgraphics("b", color);
             }
-            prev_state = cell->state;
-            prev_error = false;
+            prev_state = state;
 
             printf(" ");
         }
@@ -87,68 +86,21 @@ void gol_printer_print(const gol_printer_t* printer, const game_of_life_t* game)
     ansiescape_setgraphics("");
 }
 
-
-/* Structure that contains parameters for writing a Game of Life into a
- * PPM Image Buffer. */
-struct gol_to_ppm_params {
-    /* A floating point number representing the scale of the game
-     * mapped on to the image buffer. Note that no anti-aliasing is
-     * performed. */
-    float scale;
-
-    /* X and Y offset of the Game of Life in the PPM Image Buffer. */
-    uint16_t xoff, yoff;
-
-    /* The color of an alive cell. */
-    ppm_pixel_t calive;
-
-    /* The color of a dead cell. */
-    ppm_pixel_t cdead;
-
-    /* The Game of Life to write. */
-    const game_of_life_t* game;
-
-    /* The PPM Image Buffer to fill. */
-    const ppm_pixel_buffer_t* buffer;
-};
-
-bool gol_to_ppm(const struct gol_to_ppm_params params) {
-    if (params.scale <= 0.0001) {
-        return false;
+#ifndef GOL_NO_PROFILE
+/* Print the rolling median of a phase in milliseconds, and its 99th
+ * percentile if it is far off. */
+static void gol_print_phase(GOL_PHASE phase) {
+    gol_profile_summary_t summary;
+    if (!gol_profile_summary(phase, &summary)) return;
+    printf(", %s %.2fms", gol_profile_phase_name(phase), summary.p50 / 1e6);
+    if (summary.p99 > summary.p50 * 2) {
+        printf(" (p99 %.2fms)", summary.p99 / 1e6);
     }
-    if (params.game == NULL || params.buffer == NULL) {
-        return false;
-    }
-
-    int i, j, x, y;
-    for (j=0; j < params.buffer->height; j++) {
-        y = params.yoff + ((float) j * params.scale);
-        if (y >= params.game->height) break;
-
-        for (i=0; i < params.buffer->width; i++) {
-            x = params.xoff + ((float) i * params.scale);
-            if (x >= params.game->width) break;
-
-            const cell_t* cell = game_of_life_cell(params.game, x, y);
-            ppm_pixel_t* pixel = ppm_pixel_buffer_get(params.buffer, i, j);
-
-            if (cell == NULL || pixel == NULL) {
-                fprintf(stderr, "gol_to_ppm() at (%u, %u) -> (%u, %u) got "
-                                "cell:0x%zx, pixel:0x%zx\n", i, j, x, y,
-                                (size_t) cell, (size_t) pixel);
-                break;
-            }
-
-            if (cell->state) *pixel = params.calive;
-            else *pixel = params.cdead;
-        }
-    }
-
-    return true;
 }
+#endif
 
 
-int main() {
+int main(int argc, char** argv) {
     int i;
 
     /* Retrieve the width and height of the Terminal. */
@@ -178,8 +130,19 @@ int main() {
         " X  X"
         "  XXX";
 
-    for (i=0; i < width / 25 - 1; i++) {
-        game_of_life_draw_pattern(game, pattern, 20 + i * 25, 10 + i, 5, 7, GOL_ROT_0, GOL_FLIP_0, true);
+    /* A pattern file in one of the formats of golpattern.h may be passed
+     * on the command line instead. */
+    if (argc > 1) {
+        if (!gol_pattern_load(game, argv[1], GOL_PATTERN_AUTO, 0, 0, NULL)) {
+            fprintf(stderr, "Pattern %s could not be loaded.\n", argv[1]);
+            game_of_life_destroy(game);
+            return -1;
+        }
+    }
+    else {
+        for (i=0; i < width / 25 - 1; i++) {
+            game_of_life_draw_pattern(game, pattern, 20 + i * 25, 10 + i, 5, 7, GOL_ROT_0, GOL_FLIP_0, true);
+        }
     }
     // game_of_life_draw_glidergun(game, 0, 0, GOL_ROT_0, GOL_FLIP_0);
 
@@ -187,21 +150,85 @@ int main() {
     gol_printer_t printer;
     printer.color_alive = ANSICOLOR_YELLOW;
     printer.color_dead = ANSICOLOR_BLACK;
+    printer.max_height = 0;
+
+    /* Stop calculating once the board repeats itself. If false, the cycle
+     * keeps being displayed, but the program idles between the frames. */
+    bool stop_on_cycle = true;
+
+#ifndef GOL_NO_PROFILE
+    /* Show the times of the steps, of rendering and of writing to the
+     * Terminal in the status line. */
+    bool show_profile = true;
+#endif
+
+    /* A frame is rendered into the buffer of stdout as a whole and written
+     * with a single flush. */
+    static char output[4 << 20];
+    setvbuf(stdout, output, _IOFBF, sizeof(output));
+
+    /* The generations are calculated on a thread of their own, which
+     * publishes each of them as a frame. The Terminal shows the latest
+     * frame at its own pace, so printing never holds up the calculation. */
+    gol_triple_t* frames = gol_triple_create(game->width, game->height);
+    gol_runner_t* runner = NULL;
+    if (frames) {
+        runner = gol_runner_start(game, frames, 50 * 1000, stop_on_cycle);
+    }
+    if (!runner) {
+        fprintf(stderr, "Simulation thread could not be started.\n");
+        gol_triple_destroy(frames);
+        game_of_life_destroy(game);
+        return -1;
+    }
 
     bool running = true;
     while (running) {
+        bool fresh;
+        const gol_frame_t* frame = gol_triple_acquire(frames, &fresh);
+        if (!fresh) {
+            usleep(10 * 1000);
+            continue;
+        }
+
         ansiescape_winsize(&height, &width);
         if (height > 2) height -= 2;
         printer.max_width = width;
 
+        GOL_PROFILE_BEGIN(render);
         ansiescape_clear();
         ansiescape_setcursor(0, 0);
-        gol_printer_print(&printer, game);
-        game_of_life_next_generation(game);
-        printf("%sGeneration: %"PRId64"\n", ANSIESCAPE_ERASE_LINE, game->generation);
-        usleep(50 * 1000);
+        gol_printer_print(&printer, frame);
+        printf("%sGeneration: %"PRId64, ANSIESCAPE_ERASE_LINE, frame->generation);
+        printf(", population: %"PRIu64" (+%"PRIu64" -%"PRIu64")",
+               frame->stats.population, frame->stats.births, frame->stats.deaths);
+        if (frame->period) {
+            printf(" (cycle of period %"PRIu32")", frame->period);
+        }
+#ifndef GOL_NO_PROFILE
+        if (show_profile) {
+            gol_print_phase(GOL_PHASE_STEP);
+            gol_print_phase(GOL_PHASE_RENDER);
+            gol_print_phase(GOL_PHASE_IO);
+            printf(", dropped %"PRIu64,
+                   gol_profile_counter(GOL_COUNTER_FRAMES_DROPPED));
+        }
+#endif
+        printf("\n");
+        GOL_PROFILE_END(render, GOL_PHASE_RENDER);
+
+        GOL_PROFILE_BEGIN(io);
+        GOL_PROFILE_COUNT(GOL_COUNTER_BYTES, __fpending(stdout));
+        fflush(stdout);
+        GOL_PROFILE_END(io, GOL_PHASE_IO);
+
+        if (frame->period && stop_on_cycle) {
+            running = false;
+        }
     }
 
+    gol_runner_stop(runner);
+    gol_triple_destroy(frames);
     game_of_life_destroy(game);
     game = NULL;
     return 0;
@@ -0,0 +1,125 @@
+/* Copyright (c) 2015  Donkey Coding Group
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * file: sol-test.c
+ * description: Regression tests of the Game of Life
+ * author: Donkey Coding Group
+ *
+ * This program runs every test and prints the ones that failed. It exits
+ * with a non-zero status if any did:
+ *
+ *     $ build/sol-test */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "../src/gol.h"
+
+/* Draws a vertical blinker with its top cell at (x, y). */
+static void sol_test_blinker(const game_of_life_t* game, int32_t x, int32_t y) {
+    game_of_life_cell_set(game, x, y, true);
+    game_of_life_cell_set(game, x, y + 1, true);
+    game_of_life_cell_set(game, x, y + 2, true);
+}
+
+/* Steps a game until it found a cycle. Returns false if it found none. */
+static bool sol_test_find_cycle(game_of_life_t* game) {
+    int i;
+    for (i=0; i < 16 && !game->period; i++) {
+        game_of_life_next_generation(game);
+    }
+    return game->period != 0;
+}
+
+/* A rule change after a cycle was found ends the cycle: with B3/S, the
+ * blinker dies in the next generation. */
+static bool sol_test_fast_forward_rule(void) {
+    game_of_life_t* game = game_of_life_create(20, 20, false);
+    bool success = false;
+    if (game == NULL) return false;
+    sol_test_blinker(game, 10, 10);
+    if (sol_test_find_cycle(game) && game_of_life_set_rule(game, "B3/S")) {
+        game_of_life_fast_forward(game, game->generation + 1000);
+        success = game_of_life_population(game) == 0;
+    }
+    game_of_life_destroy(game);
+    return success;
+}
+
+/* Cells drawn next to a cycling blinker end the cycle, so fast forwarding
+ * gives the same board as single steps. */
+static bool sol_test_fast_forward_edit(void) {
+    game_of_life_t* games[2] = {
+        game_of_life_create(40, 40, false),
+        game_of_life_create(40, 40, false),
+    };
+    bool success = false;
+    int i;
+
+    if (games[0] && games[1]) {
+        success = true;
+        for (i=0; i < 2; i++) {
+            sol_test_blinker(games[i], 20, 20);
+            success = success && sol_test_find_cycle(games[i]);
+            game_of_life_cell_set(games[i], 22, 20, true);
+            game_of_life_cell_set(games[i], 22, 21, true);
+            game_of_life_cell_set(games[i], 23, 21, true);
+        }
+        uint64_t target = games[0]->generation + 1000;
+        game_of_life_fast_forward(games[0], target);
+        while (games[1]->generation < target) {
+            game_of_life_next_generation(games[1]);
+        }
+        success = success &&
+                  game_of_life_hash(games[0]) == game_of_life_hash(games[1]) &&
+                  game_of_life_population(games[0]) ==
+                  game_of_life_population(games[1]);
+    }
+    game_of_life_destroy(games[0]);
+    game_of_life_destroy(games[1]);
+    return success;
+}
+
+/* A test and its name. */
+typedef struct sol_test {
+    const char* name;
+    bool (*run)(void);
+} sol_test_t;
+
+static const sol_test_t sol_tests[] = {
+    {"fast_forward_rule", sol_test_fast_forward_rule},
+    {"fast_forward_edit", sol_test_fast_forward_edit},
+};
+
+
+int main(void) {
+    size_t count = sizeof(sol_tests) / sizeof(sol_tests[0]);
+    size_t failed = 0;
+    size_t i;
+    for (i=0; i < count; i++) {
+        if (!sol_tests[i].run()) {
+            printf("FAILED %s\n", sol_tests[i].name);
+            failed++;
+        }
+    }
+    printf("%zu of %zu tests passed\n", count - failed, count);
+    return failed ? 1 : 0;
+}